@@ -0,0 +1,103 @@
+/*
+  Copyright (c) 1998 - 2026
+  CLST  - Radboud University
+  ILK   - Tilburg University
+  CLiPS - University of Antwerp
+
+  This file is part of mbt
+
+  mbt is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  mbt is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/mbt/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+#ifndef MBT_BUNDLE_H
+#define MBT_BUNDLE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+namespace Tagger {
+
+  // A model bundle is one binary file with named sections of raw data.
+  // mbt maps it into memory and uses the sections as they are, so there
+  // is nothing to parse, and processes using the same bundle share the
+  // pages. The Timbl case bases are not in a bundle, Timbl reads those
+  // itself.
+  //
+  // The layout is a header, a table of sections and then the sections,
+  // each aligned on 64 bytes. Numbers are stored as the machine that
+  // wrote the bundle has them. The header records the byte order and the
+  // word size, and a bundle for another kind of machine is refused.
+  //
+  class BundleWriter {
+  public:
+    void add( const std::string&, const void *, size_t );
+    template<typename T>
+      void add( const std::string& name, const std::vector<T>& v ){
+      add( name, v.data(), v.size() * sizeof(T) );
+    }
+    void add_strings( const std::string&, const std::vector<std::string>& );
+    bool write( const std::string& ) const;
+  private:
+    std::vector<std::pair<std::string,std::string>> sections;
+  };
+
+  class Bundle {
+  public:
+    Bundle(): data(0), length(0), mapped(false) {};
+    ~Bundle();
+    bool open( const std::string& );
+    bool has( const std::string& ) const;
+    const void *section( const std::string&, size_t& ) const;
+    template<typename T>
+      const T *array( const std::string& name, size_t& n ) const {
+      size_t bytes = 0;
+      const T *result = static_cast<const T*>( section( name, bytes ) );
+      n = bytes / sizeof(T);
+      return result;
+    }
+    bool strings( const std::string&, std::vector<std::string>& ) const;
+  private:
+    Bundle( const Bundle& ); // inhibit copies
+    Bundle& operator=( const Bundle& ); // inhibit copies
+    const char *data;
+    size_t length;
+    bool mapped;
+    std::map<std::string,std::pair<size_t,size_t>> sections;
+  };
+
+  // a read only array, which lives either in a vector of its owner or
+  // in a Bundle
+  template<typename T>
+    class array_view {
+  public:
+  array_view(): ptr(0), len(0) {};
+    void set( const std::vector<T>& v ){ ptr = v.data(); len = v.size(); };
+    void set( const T *p, size_t n ){ ptr = p; len = n; };
+    const T& operator[]( size_t i ) const { return ptr[i]; };
+    const T *data() const { return ptr; };
+    size_t size() const { return len; };
+    bool empty() const { return len == 0; };
+  private:
+    const T *ptr;
+    size_t len;
+  };
+
+}
+#endif
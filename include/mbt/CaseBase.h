@@ -0,0 +1,121 @@
+/*
+  Copyright (c) 1998 - 2026
+  CLST  - Radboud University
+  ILK   - Tilburg University
+  CLiPS - University of Antwerp
+
+  This file is part of mbt
+
+  mbt is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  mbt is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/mbt/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+#ifndef MBT_CASEBASE_H
+#define MBT_CASEBASE_H
+
+#include <string>
+#include <vector>
+#include "mbt/SymbolTable.h"
+#include "mbt/Bundle.h"
+
+namespace Tagger {
+
+  class Classification;
+
+  // mbtg can store the training instances in a compact form: identical
+  // feature vectors are merged, and the classes are numbered in order of
+  // first appearance, which is also the order Timbl uses.
+  //
+  // The file looks like:
+  //   MBT-CASEBASE 1
+  //   features <n>
+  //   classes <k> <class_1> ... <class_k>
+  //   <value_1> ... <value_n> <class>:<count> ...
+  //
+  bool write_case_base( const std::string&, const std::string& );
+
+  // The instances of a compact case base file. The values and the
+  // classes are stored as symbol numbers.
+  //
+  class CaseBase {
+  public:
+    CaseBase(): num_features(0) {};
+    bool read( const std::string&, SymbolTable& );
+    size_t size() const { return dist_begin.empty() ? 0 : dist_begin.size()-1; };
+    int value( size_t i, size_t f ) const { return values[i*num_features+f]; };
+    double weight( size_t ) const;
+    void gain_ratios( std::vector<double>& ) const;
+    void global_counts( std::vector<double>& ) const;
+    size_t num_features;
+    std::vector<int> classes;         //!< symbols of the classes
+    std::vector<int> values;          //!< row major: instance by feature
+    std::vector<size_t> dist_begin;   //!< per instance: first entry in dist
+    std::vector<std::pair<int,double>> dist; //!< class index and count
+  private:
+    CaseBase( const CaseBase& ); // inhibit copies
+    CaseBase& operator=( const CaseBase& ); // inhibit copies
+  };
+
+  void fill_classification( const std::pair<int,double> *,
+			    size_t,
+			    const std::vector<int>&,
+			    size_t,
+			    bool,
+			    SymbolTable&,
+			    Classification& );
+
+  // An IGTREE in a flat layout. The nodes are stored breadth first, so
+  // the children of a node are adjacent, sorted on their value. Every node
+  // keeps its default class and its class distribution.
+  // The tree is read from the instance base file Timbl writes for an
+  // IGTREE, so it has Timbl's feature order and pruning. The nodes and
+  // distributions are read, or used straight from a Bundle.
+  //
+  class FlatIGTree {
+  public:
+    FlatIGTree(){};
+    bool read( const std::string&, SymbolTable& );
+    void classify( const std::vector<int>&,
+		   bool,
+		   SymbolTable&,
+		   Classification& ) const;
+    size_t num_nodes() const { return node_data.size(); };
+    size_t num_features() const { return order.size(); };
+    void save( BundleWriter&, const std::string& ) const;
+    bool attach( const Bundle&, const std::string& );
+  private:
+    FlatIGTree( const FlatIGTree& ); // inhibit copies
+    FlatIGTree& operator=( const FlatIGTree& ); // inhibit copies
+    class node {
+    public:
+      int value;
+      unsigned int first_child;
+      unsigned int num_children;
+      unsigned int dist_offset;
+      unsigned int dist_size;
+      unsigned int answer;            //!< the default class, in the dist
+    };
+    std::vector<size_t> order;        //!< features in the order of the tree
+    std::vector<node> nodes;
+    std::vector<std::pair<int,double>> dists; //!< class index and count
+    std::vector<int> classes;
+    array_view<node> node_data;
+    array_view<std::pair<int,double>> dist_data;
+  };
+
+}
+#endif
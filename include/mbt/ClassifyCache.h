@@ -0,0 +1,70 @@
+/*
+  Copyright (c) 1998 - 2026
+  CLST  - Radboud University
+  ILK   - Tilburg University
+  CLiPS - University of Antwerp
+
+  This file is part of mbt
+
+  mbt is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  mbt is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/mbt/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+#ifndef MBT_CLASSIFYCACHE_H
+#define MBT_CLASSIFYCACHE_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include "mbt/Tagger.h"
+
+namespace Tagger {
+
+  // A bounded cache of classifications, keyed on the feature pattern.
+  // When full, the least recently used entry is dropped.
+  // Not meant to be shared between threads: every tagger has its own.
+  //
+  class ClassifyCache {
+  public:
+    explicit ClassifyCache( size_t );
+    bool lookup( const std::vector<int>&, Classification& );
+    void store( const std::vector<int>&, const Classification& );
+    void add_counts( const ClassifyCache& );
+    size_t capacity() const { return max_size; };
+    size_t size() const { return index.size(); };
+    size_t hits() const { return num_hits; };
+    size_t misses() const { return num_misses; };
+  private:
+    ClassifyCache( const ClassifyCache& ); // inhibit copies
+    ClassifyCache& operator=( const ClassifyCache& ); // inhibit copies
+    class key_hash {
+    public:
+      size_t operator()( const std::vector<int>& ) const;
+    };
+    typedef std::list<std::pair<std::vector<int>,Classification>> entry_list;
+    size_t max_size;
+    entry_list entries;  // most recently used first
+    std::unordered_map<std::vector<int>,
+		       entry_list::iterator,
+		       key_hash> index;
+    size_t num_hits;
+    size_t num_misses;
+  };
+
+}
+#endif
@@ -29,6 +29,10 @@
 #ifndef MBT_API_H
 #define MBT_API_H
 
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include "timbl/TimblAPI.h"
 #include "ticcutils/UniHash.h"
 #include "mbt/Tagger.h"
@@ -48,12 +52,29 @@ class MbtAPI {
   bool isInit() const;
   icu::UnicodeString Tag( const icu::UnicodeString& );
   std::vector<Tagger::TagResult> TagLine( const icu::UnicodeString& );
+  std::vector<std::vector<Tagger::TagResult>> TagLines( const std::vector<icu::UnicodeString>& );
   icu::UnicodeString getResult( const std::vector<Tagger::TagResult>& ) const;
   icu::UnicodeString set_eos_mark( const icu::UnicodeString& );
+  size_t poolSize() const { return sessions.size(); };
+  size_t poolRequests() const { return pool_requests; };
+  size_t poolWaits() const { return pool_waits; };
+  double poolWaitTime() const;
  private:
   MbtAPI( const MbtAPI& ); // inhibit copies
   MbtAPI& operator=( const MbtAPI& ); // inhibit copies
+  void init_pool();
+  Tagger::TaggerClass *acquire();
+  void release( Tagger::TaggerClass * );
+  friend class session_guard;
   Tagger::TaggerClass *tagger;
+  std::vector<Tagger::TaggerClass*> sessions;
+  std::vector<Tagger::TaggerClass*> free_sessions;
+  std::mutex pool_lock;
+  std::mutex batch_lock;
+  std::condition_variable pool_cond;
+  std::atomic<size_t> pool_requests;
+  std::atomic<size_t> pool_waits;
+  std::atomic<long long> pool_wait_ns;
 };
 
 #endif
@@ -0,0 +1,121 @@
+/*
+  Copyright (c) 1998 - 2026
+  CLST  - Radboud University
+  ILK   - Tilburg University
+  CLiPS - University of Antwerp
+
+  This file is part of mbt
+
+  mbt is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  mbt is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/mbt/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+#ifndef MBT_NATIVEIB1_H
+#define MBT_NATIVEIB1_H
+
+#include <string>
+#include <vector>
+#include "mbt/SymbolTable.h"
+#include "mbt/Bundle.h"
+
+namespace Tagger {
+
+  class Classification;
+  class CaseBase;
+
+  // the per thread state of a NativeIB1 search
+  class IB1Scratch {
+  public:
+    std::vector<double> sim;
+    std::vector<unsigned int> touched;
+    std::vector<double> acc;
+    std::vector<int> seen;
+    std::vector<std::pair<int,double>> entries;
+    std::vector<const int*> cols;
+    std::vector<int> query;
+    std::vector<double> query_weights;
+  };
+
+  // IB1 with the overlap metric, gain ratio weights and k=1.
+  //
+  // By default it searches through an inverted index: for every feature
+  // value we keep the instances that have it. A pattern only visits the
+  // lists of its own values, the heaviest features first. As soon as no
+  // instance outside the candidates can still reach the best similarity
+  // found so far, the remaining features only refine the candidates. So
+  // the search stays exact, unless a cap on the number of candidates is
+  // given.
+  //
+  // In scan mode it compares the pattern with all instances, which are
+  // stored column by column, using AVX2 or SSE4.1 when the cpu has it.
+  // Both modes find exactly the same neighbours.
+  //
+  // When two or more classes share the highest count among the nearest
+  // neighbours, classify() gives up and returns false. Timbl's way to
+  // break such a tie is left to Timbl.
+  //
+  class NativeIB1 {
+  public:
+    explicit NativeIB1( size_t cap=0, bool scan=false ):
+      max_candidates(cap), use_scan(scan){};
+    void build( const CaseBase& );
+    bool classify( const std::vector<int>&,
+		   bool,
+		   SymbolTable&,
+		   IB1Scratch&,
+		   Classification& ) const;
+    size_t size() const {
+      return dist_begin_data.empty() ? 0 : dist_begin_data.size()-1; };
+    void save( BundleWriter&, const std::string& ) const;
+    bool attach( const Bundle&, const std::string& );
+    static const char *kernel_name();
+  private:
+    NativeIB1( const NativeIB1& ); // inhibit copies
+    NativeIB1& operator=( const NativeIB1& ); // inhibit copies
+    double search( const std::vector<int>&, IB1Scratch& ) const;
+    double scan( const std::vector<int>&, IB1Scratch& ) const;
+    void make_columns();
+    size_t max_candidates;          //!< 0 means: exact
+    bool use_scan;
+    size_t num_features;
+    std::vector<size_t> order;      //!< features by descending weight
+    std::vector<double> weights;
+    double total_weight;
+    std::vector<double> global;     //!< class counts over all instances
+    std::vector<int> classes;
+    std::vector<int> columns;       //!< column major, for scan mode
+    // the index: the keys of feature f are keys[feature_keys[f]] up to
+    // keys[feature_keys[f+1]], sorted. The instances with key k are
+    // postings[key_begin[k]] up to postings[key_begin[k+1]]
+    std::vector<size_t> feature_keys;
+    // the big arrays, built by us or used from a Bundle
+    std::vector<int> values;        //!< row major: instance by feature
+    std::vector<size_t> dist_begin;
+    std::vector<std::pair<int,double>> dist; //!< class index and count
+    std::vector<unsigned int> postings;
+    std::vector<int> keys;
+    std::vector<size_t> key_begin;
+    array_view<int> value_data;
+    array_view<size_t> dist_begin_data;
+    array_view<std::pair<int,double>> dist_data;
+    array_view<unsigned int> postings_data;
+    array_view<int> key_data;
+    array_view<size_t> key_begin_data;
+  };
+
+}
+#endif
@@ -0,0 +1,78 @@
+/*
+  Copyright (c) 1998 - 2026
+  CLST  - Radboud University
+  ILK   - Tilburg University
+  CLiPS - University of Antwerp
+
+  This file is part of mbt
+
+  mbt is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  mbt is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/mbt/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+#ifndef MBT_SCHEDULER_H
+#define MBT_SCHEDULER_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+#include <atomic>
+#include <functional>
+
+namespace Tagger {
+
+  // A work-stealing scheduler for batches of independent tasks.
+  // The worker threads live as long as the scheduler, and wait for the
+  // next batch between run() calls.
+  //
+  class TaskScheduler {
+  public:
+    explicit TaskScheduler( size_t );
+    ~TaskScheduler();
+    size_t size() const { return queues.size(); };
+    void run( const std::vector<size_t>&,
+	      const std::function<void(size_t,size_t)>& );
+    size_t steals() const { return num_steals; };
+  private:
+    TaskScheduler( const TaskScheduler& ); // inhibit copies
+    TaskScheduler& operator=( const TaskScheduler& ); // inhibit copies
+    class worker_queue {
+    public:
+      std::mutex lock;
+      std::deque<size_t> tasks;
+    };
+    bool next_task( size_t, size_t& );
+    void work( size_t );
+    std::vector<worker_queue*> queues;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> num_steals;
+    std::atomic<bool> aborted;
+    std::mutex batch_lock;
+    std::condition_variable batch_start;
+    std::condition_variable batch_done;
+    const std::function<void(size_t,size_t)> *job;
+    std::exception_ptr failure;
+    size_t generation;
+    size_t busy;
+    bool stopping;
+  };
+
+}
+#endif
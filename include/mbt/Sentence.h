@@ -28,10 +28,9 @@
 #define MBT_SENTENCE_H
 
 #include "ticcutils/Unicode.h"
-#include "ticcutils/UniHash.h"
+#include "mbt/SymbolTable.h"
 
 namespace Tagger {
-  using Hash::UnicodeHash;
 
   const icu::UnicodeString DOT = "==";
   const icu::UnicodeString UNKNOWN = "__";
@@ -69,15 +68,16 @@ namespace Tagger {
     sentence( const PatTemplate&, const PatTemplate& );
     ~sentence();
     void clear();
+    void take_over( sentence& );
     bool init_windowing( const std::map<icu::UnicodeString, icu::UnicodeString>&,
-			 UnicodeHash& );
+			 SymbolTable& );
     bool nextpat( MatchAction&,
 		  std::vector<int>&,
-		  UnicodeHash&,
-		  UnicodeHash&,
+		  SymbolTable&,
+		  SymbolTable&,
 		  unsigned int,
 		  const std::vector<int>& ) const;
-    int classify_hapax( const icu::UnicodeString&, UnicodeHash& ) const;
+    int classify_hapax( const icu::UnicodeString&, SymbolTable& ) const;
     void assign_tag( int, unsigned int );
     icu::UnicodeString getword( unsigned int i ) const {
       return Words[i]->the_word;
@@ -85,6 +85,9 @@ namespace Tagger {
     icu::UnicodeString& gettag( int i ) const {
       return Words[i]->word_tag;
     };
+    int getambitag( unsigned int i ) const {
+      return Words[i]->word_amb_tag;
+    };
     const std::vector<icu::UnicodeString>& getEnrichments( unsigned int i ) const {
       return Words[i]->extraFeatures;
     };
@@ -0,0 +1,105 @@
+/*
+  Copyright (c) 1998 - 2026
+  CLST  - Radboud University
+  ILK   - Tilburg University
+  CLiPS - University of Antwerp
+
+  This file is part of mbt
+
+  mbt is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  mbt is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/mbt/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+#ifndef MBT_SYMBOLTABLE_H
+#define MBT_SYMBOLTABLE_H
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include "ticcutils/Unicode.h"
+
+namespace Tagger {
+
+  // A table of interned strings, which may be used from several threads.
+  // Symbols are numbered from 1 upward. 0 means 'not found'.
+  //
+  // Looking up a known symbol takes no locks. New symbols are inserted
+  // under the lock of one of a number of shards, and numbered under one
+  // short shared lock.
+  //
+  // A table may be stacked as an overlay on a frozen base table. Symbols
+  // of the base keep their numbers, new symbols are numbered after the
+  // last base symbol and are stored in the overlay only, so the base is
+  // never written to. clear() drops the overlay symbols again.
+  //
+  class SymbolTable {
+  public:
+    SymbolTable();
+    ~SymbolTable();
+    unsigned int hash( const icu::UnicodeString& );
+    unsigned int lookup( const icu::UnicodeString& ) const;
+    const icu::UnicodeString& reverse_lookup( unsigned int ) const;
+    unsigned int num_of_entries() const { return base_size + entries; };
+    void set_base( const SymbolTable * );
+    const SymbolTable *get_base() const { return base; };
+    bool in_base( unsigned int id ) const { return id <= base_size; };
+    void clear();
+  private:
+    SymbolTable( const SymbolTable& ); // inhibit copies
+    SymbolTable& operator=( const SymbolTable& ); // inhibit copies
+    class node {
+    public:
+      node( int32_t h, unsigned int i, node *n ): hash_val(h), id(i), next(n){};
+      int32_t hash_val;
+      unsigned int id;
+      node *next;
+    };
+    class bucket_array {
+    public:
+      explicit bucket_array( size_t );
+      ~bucket_array();
+      size_t size;
+      std::atomic<node*> *heads;
+    };
+    class shard {
+    public:
+      shard();
+      ~shard();
+      std::mutex lock;
+      std::atomic<bucket_array*> buckets;
+      size_t count;
+      std::vector<bucket_array*> retired; // freed by clear() or ~shard()
+      std::vector<node*> nodes;           // all nodes, also the retired
+    };
+    static const size_t NUM_SHARDS = 64;
+    static const size_t NUM_SEGMENTS = 32;
+    static const size_t FIRST_SEGMENT = 256;
+    unsigned int find( const shard&, int32_t,
+		       const icu::UnicodeString& ) const;
+    void grow( shard& );
+    icu::UnicodeString& slot( unsigned int );
+    const icu::UnicodeString& local_symbol( unsigned int ) const;
+    shard shards[NUM_SHARDS];
+    std::atomic<icu::UnicodeString*> segments[NUM_SEGMENTS];
+    std::mutex id_lock; // numbers new symbols, and stores their strings
+    std::atomic<unsigned int> entries;
+    const SymbolTable *base;
+    unsigned int base_size;
+  };
+
+}
+#endif
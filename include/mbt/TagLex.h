@@ -42,6 +42,7 @@ namespace Tagger {
 	     const icu::UnicodeString& );
     ~TagInfo();
     void Update( const icu::UnicodeString& s );
+    void Merge( const TagInfo& );
     void Prune( int perc );
     int Freq() const { return WordFreq; };
     icu::UnicodeString stringRep() { return StringRepr; };
@@ -62,6 +63,7 @@ namespace Tagger {
     TagInfo *Lookup( const icu::UnicodeString& );
     TagInfo *Store( const icu::UnicodeString&,
 		    const icu::UnicodeString&  );
+    void Merge( const TagLex& );
     std::vector<TagInfo *> CreateSortedVector();
     int numOfLexiconEntries() const { return NumOfEntries; };
   private:
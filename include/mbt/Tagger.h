@@ -28,9 +28,13 @@
 #ifndef MBT_TAGGER_H
 #define MBT_TAGGER_H
 
+#include <unordered_map>
+#include <limits>
+#include <mutex>
+#include <atomic>
 #include "mbt/Pattern.h"
 #include "mbt/Sentence.h"
-#include "ticcutils/UniHash.h"
+#include "mbt/SymbolTable.h"
 #include "ticcutils/Timer.h"
 #include "timbl/TimblAPI.h"
 
@@ -42,45 +46,101 @@ namespace TiCC {
 namespace Tagger {
 
   class TagInfo;
+  class TaskScheduler;
 
   std::string Version();
   std::string VersionName();
   double DataVersion();
+  double MinDataVersion();
 
   extern const std::string mbt_short_opts;
   extern const std::string mbt_long_opts;
 
   const int EMPTY_PATH = -1000000;
 
+  // the score of no path at all. Scores are log probabilities
+  const double NO_SCORE = -std::numeric_limits<double>::infinity();
+
   class n_best_tuple {
   public:
-    n_best_tuple(){ path = EMPTY_PATH; tag = EMPTY_PATH; prob = 0.0; }
-    void clean(){ path = EMPTY_PATH; tag = EMPTY_PATH; prob = 0.0; };
+    n_best_tuple(){ path = EMPTY_PATH; tag = EMPTY_PATH; score = NO_SCORE; }
+    void clean(){ path = EMPTY_PATH; tag = EMPTY_PATH; score = NO_SCORE; };
     int path;
     int tag;
+    double score;             //!< log probability of the extended path
+  };
+
+  // a tag with its probability. \e order is the position in the
+  // distribution it came from, to keep the order of equal ones stable
+  class tag_prob {
+  public:
+    tag_prob( int t, double p, int o ): tag(t), prob(p), order(o){};
+    int tag;
     double prob;
+    int order;
   };
 
+  // the outcome of classifying one pattern, in terms of our own symbols
+  class Classification {
+  public:
+    Classification(): answer(0), distance(0.0), confidence(0.0) {};
+    void clear(){
+      answer = 0;
+      distribution.clear();
+      distance = 0.0;
+      confidence = 0.0;
+      dist_string.clear();
+    }
+    int answer;               //!< the symbol of the winning tag
+    std::vector<std::pair<int,double>> distribution; //!< tags and weights,
+                              //!< in Timbl's order. empty when there is none
+    double distance;          //!< only set when asked for (-vdi)
+    double confidence;        //!< only set when asked for (-vcf)
+    std::string dist_string;  //!< only set when asked for (-vdb)
+  };
+
+  // split the distribution of a classification into tags and
+  // probabilities: the answer first, then the most probable others.
+  // The last argument is scratch space of the caller.
+  void break_down( const Classification&, size_t, std::vector<tag_prob>& );
+
+  // the beam is kept as a lattice: for every position and beam entry the
+  // tag and the entry at the previous position it extends. Paths are
+  // only spelled out when needed: the left context of a pattern and
+  // the final best path.
   class BeamData {
   public:
     BeamData();
     ~BeamData();
     void Init( int, unsigned int );
-    void InitPaths( Hash::UnicodeHash&,
-		    const Timbl::TargetValue *,
-		    const Timbl::ClassDistribution * );
-    void NextPath( Hash::UnicodeHash&,
-		   const Timbl::TargetValue *,
-		   const Timbl::ClassDistribution *,
-		   int );
+    void InitPaths( const Classification& );
+    void NextPath( const Classification&, int );
     void ClearBest();
-    void Shift( int, int );
-    void Print( std::ostream& os, int i_word, Hash::UnicodeHash& TheLex );
-    void PrintBest( std::ostream& os, Hash::UnicodeHash& TheLex );
+    void Shift( int );
+    void Prune( int );
+    bool same_signature( int, int, int, int ) const;
+    double posterior( int ) const;
+    int tag_at( int pos, int beam ) const {
+      return lattice_tag[pos*size+beam];
+    };
+    const std::vector<int>& Context( int, int, int );
+    const std::vector<int>& Backtrace();
+    void Print( std::ostream& os, int i_word, SymbolTable& TheLex );
+    void PrintBest( std::ostream& os, SymbolTable& TheLex );
     int size;
-    std::vector<std::vector<int>> paths;
-    std::vector<std::vector<int>> temppaths;
-    std::vector<double> path_prob;
+    int filled;                     //!< the number of positions decoded
+    int signature_depth;            //!< merge entries that agree on this
+                                    //!< many last tags. -1: never merge
+    double threshold;               //!< drop entries below this fraction
+                                    //!< of the best one. 0: keep all
+    std::vector<int> lattice_tag;   //!< per position: the tag per entry
+    std::vector<int> lattice_back;  //!< per position: the entry extended
+    std::vector<int> lattice_root;  //!< per position: the tag at position 0
+    std::vector<int> context;       //!< scratch for Context()
+    std::vector<int> best_path;     //!< the outcome of Backtrace()
+    std::vector<double> path_score; //!< log probability per entry
+    std::vector<double> cand_score; //!< scratch for NextPath()
+    std::vector<tag_prob> distr;    //!< scratch for the distributions
     std::vector<n_best_tuple>n_best_array;
   private:
     BeamData( const BeamData& ); // inhibit copies
@@ -88,6 +148,11 @@ namespace Tagger {
   };
 
   class TagResult;
+  class ClassifyCache;
+  class FlatIGTree;
+  class NativeIB1;
+  class IB1Scratch;
+  class Bundle;
 
   class TaggerClass{
   public:
@@ -103,6 +168,10 @@ namespace Tagger {
     nlohmann::json tag_line_to_JSON( const std::string& );
     nlohmann::json tag_JSON_to_JSON( const nlohmann::json& );
     std::vector<TagResult> tagSentence( sentence& );
+    std::vector<std::vector<TagResult>> tagSentences( const std::vector<sentence*>&,
+						      int );
+    std::vector<std::vector<TagResult>> tagLines( const std::vector<icu::UnicodeString>&,
+						  int );
     icu::UnicodeString Tag( const icu::UnicodeString& inp ){
       return TRtoString( tagLine(inp) );
     };
@@ -117,15 +186,18 @@ namespace Tagger {
     bool parse_create_args( TiCC::CL_Options& );
     bool parse_run_args( TiCC::CL_Options&, bool = false );
     bool isClone() const { return cloned; };
+    int threads() const { return num_threads; };
     void ShowCats( std::ostream& os, const std::vector<int>& Pat, int slots );
     bool setLog( TiCC::LogStream& );
     int ProcessLines( std::istream&, std::ostream& );
     void read_lexicon( const std::string& );
-    void read_listfile( const std::string&, Hash::UnicodeHash * );
+    void read_listfile( const std::string&, SymbolTable * );
+    void fill_base_lex();
     bool enriched() const { return input_kind == ENRICHED; };
     bool distance_is_set() const { return distance_flag; };
     bool distrib_is_set()const { return distrib_flag; };
     bool confidence_is_set() const { return confidence_flag; };
+    int top_k_size() const { return topk_size; };
     static TaggerClass *StartTagger( TiCC::CL_Options&, TiCC::LogStream* = 0 );
     static int CreateTagger( TiCC::CL_Options& );
     static int CreateTagger( const std::string& );
@@ -139,6 +211,15 @@ namespace Tagger {
     TiCC::LogStream *cur_log;
     Timbl::TimblAPI *KnownTree;
     Timbl::TimblAPI *unKnownTree;
+    bool lazy_unknown;
+    bool recombine;
+    double beam_threshold;
+    size_t beam_budget;
+    size_t beam_expanded;
+    size_t beam_positions;
+    mutable std::atomic<bool> unknown_loaded;
+    mutable std::mutex unknown_mutex;
+    const TaggerClass *unknown_master; //!< the tagger we are cloned from
     std::string Timbl_Options;
     std::string commonstr;
     std::string knownstr;
@@ -146,9 +227,10 @@ namespace Tagger {
     std::string uwf;
     std::string kwf;
     bool initialized;
-    Hash::UnicodeHash TheLex;
-    Hash::UnicodeHash *kwordlist;
-    Hash::UnicodeHash *uwordlist;
+    SymbolTable TheLex;
+    SymbolTable *BaseLex;
+    SymbolTable *kwordlist;
+    SymbolTable *uwordlist;
     BeamData *Beam;
     input_kind_type input_kind;
     bool piped_input;
@@ -165,25 +247,94 @@ namespace Tagger {
     bool distrib_flag;
     bool confidence_flag;
     bool klistflag;
+    int topk_size;
+    bool need_distribution;
+    bool need_distance;
     int Beam_Size;
+    int context_depth;   //!< how far back nextpat() looks in a path
+    int num_threads;
+    size_t cache_size;
+    ClassifyCache *cache;
+    std::vector<int> cache_key;
+    bool fast_unambiguous;
+    bool check_unambiguous;
+    size_t unambiguous_checked;
+    size_t unambiguous_disagreements;
+    bool write_native;
+    bool native_known;
+    bool check_native;
+    FlatIGTree *NativeKnown;
+    size_t native_checked;
+    size_t native_disagreements;
+    bool native_unknown;
+    size_t unknown_candidates;
+    bool unknown_scan;
+    NativeIB1 *NativeUnknown;
+    IB1Scratch *ib1_scratch;
+    size_t native_unknown_checked;
+    size_t native_unknown_disagreements;
+    size_t native_unknown_ties;
+    bool write_bundle;
+    bool bundleflag;
+    Bundle *ModelBundle;
     std::vector<double> distance_array;
     std::vector<std::string> distribution_array;
     std::vector<double> confidence_array;
+    std::vector<std::vector<std::pair<int,double>>> topk_array;
+    std::vector<tag_prob> topk_scratch;
     TiCC::Timer timer1;
     TiCC::Timer timer2;
     TiCC::Timer timer3;
 
     int makedataset( std::istream& infile, bool do_known );
+    int makedatasets( std::istream& infile );
+    int window_sentence( sentence&, bool, std::ostream& );
+    int CreateInstances();
+    bool learn_case_base( bool );
     bool readsettings( std::string& fname );
     bool create_lexicons();
     int ProcessFile( std::istream&, std::ostream& );
+    int ProcessFileParallel( std::istream&, std::ostream& );
+    void show_statistics( int no_words,
+			  int no_known,
+			  int no_unknown,
+			  int no_correct_known,
+			  int no_correct_unknown,
+			  bool timbl_stats );
     void ProcessTags( TagInfo * );
     void InitTest( const sentence&, const std::vector<int>&, MatchAction );
-    bool NextBest( const sentence&, std::vector<int>&, int, int );
+    int NextBests( const sentence&, int, int );
+    void set_classify_needs();
+    void store_outputs( const Classification&, int );
     const Timbl::TargetValue *Classify( MatchAction,
 					const icu::UnicodeString&,
 					const Timbl::ClassDistribution *&,
 					double& );
+    void Classify( MatchAction,
+		   const sentence&,
+		   const std::vector<int>&,
+		   int,
+		   Classification& );
+    void classify_timbl( MatchAction,
+			 const sentence&,
+			 const std::vector<int>&,
+			 int,
+			 Classification& );
+    void classify_pattern( MatchAction,
+			   const sentence&,
+			   const std::vector<int>&,
+			   int,
+			   Classification& );
+    bool init_native_known();
+    bool init_native_unknown();
+    bool read_known_tree();
+    bool read_unknown_tree() const;
+    bool ensure_unknown_tree();
+    bool load_bundle();
+    bool save_bundle( const std::string& );
+    bool CreateBundle();
+    int target_symbol( const Timbl::TargetValue * );
+    bool unambiguous( int );
     void statistics( const sentence&,
 		     int& no_known,
 		     int& no_unknown,
@@ -222,12 +373,14 @@ namespace Tagger {
     std::string MTLexFileBaseName;
     std::string TopNFileBaseName;
     std::string NpaxFileBaseName;
+    std::string BundleBaseName;
     std::string UnknownTreeName;
     std::string KnownTreeName;
     std::string LexFileName;
     std::string MTLexFileName;
     std::string TopNFileName;
     std::string NpaxFileName;
+    std::string BundleName;
     std::string TestFileName;
     std::string TestFilePath;
     std::string OutputFileName;
@@ -236,6 +389,13 @@ namespace Tagger {
     std::string SettingsFilePath;
 
     bool cloned;
+    std::vector<TaggerClass*> batch_workers;
+    TaskScheduler *batch_scheduler;
+    std::unordered_map<const Timbl::TargetValue*,int> target_symbols;
+    Classification classification;
+    std::vector<std::vector<int>> beam_patterns;
+    std::vector<int> beam_unique;
+    std::vector<Classification> beam_results;
   };
 
   class TagResult {
@@ -266,12 +426,18 @@ namespace Tagger {
 
     double distance() const { return _distance; };
     void set_distance( double c ){ _distance = c; };
+
+    const std::vector<std::pair<icu::UnicodeString,double>>& top_k() const {
+      return _top_k; };
+    void set_top_k( const std::vector<std::pair<icu::UnicodeString,double>>& t ){
+      _top_k = t; };
   private:
     icu::UnicodeString _word;
     icu::UnicodeString _input_tag;
     icu::UnicodeString _tag;
     icu::UnicodeString _enrichment;
     icu::UnicodeString _distribution;
+    std::vector<std::pair<icu::UnicodeString,double>> _top_k; //!< tag, probability
     double _distance;
     double _confidence;
     bool _known;
@@ -279,7 +445,7 @@ namespace Tagger {
 
   std::vector<TagResult> StringToTR( const std::string&, bool=false );
 
-  const icu::UnicodeString& indexlex( const unsigned int, Hash::UnicodeHash& );
+  const icu::UnicodeString& indexlex( const unsigned int, SymbolTable& );
   void get_weightsfile_name( std::string& opts, std::string& );
   void splits( const std::string& , std::string& common,
 	       std::string& known, std::string& unknown );
@@ -0,0 +1,234 @@
+/*
+  Copyright (c) 1998 - 2026
+  CLST  - Radboud University
+  ILK   - Tilburg University
+  CLiPS - University of Antwerp
+
+  This file is part of mbt
+
+  mbt is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  mbt is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/mbt/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mbt/Bundle.h"
+
+namespace Tagger {
+  using namespace std;
+
+  const char BUNDLE_MAGIC[8] = { 'M', 'B', 'T', 'B', 'N', 'D', 'L', '\0' };
+  const uint32_t BUNDLE_VERSION = 1;
+  const uint32_t BYTE_ORDER_MARK = 0x01020304;
+  const size_t BUNDLE_ALIGN = 64;
+  const size_t NAME_SIZE = 48;
+
+  class bundle_header {
+  public:
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t word_size;
+    uint32_t num_sections;
+  };
+
+  class bundle_entry {
+  public:
+    char name[NAME_SIZE];
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  static size_t aligned( size_t pos ){
+    return ( pos + BUNDLE_ALIGN - 1 ) / BUNDLE_ALIGN * BUNDLE_ALIGN;
+  }
+
+  void BundleWriter::add( const string& name, const void *p, size_t size ){
+    /// add a section \e name, holding a copy of \e size bytes at \e p
+    if ( name.size() >= NAME_SIZE ){
+      throw logic_error( "bundle section name too long: " + name );
+    }
+    sections.push_back( make_pair( name,
+				   string( static_cast<const char*>(p), size ) ) );
+  }
+
+  void BundleWriter::add_strings( const string& name,
+				  const vector<string>& strings ){
+    /// add a section \e name with a list of strings
+    /*!
+      The section holds the number of strings, the offsets of the
+      strings (one more than there are strings), and then the strings.
+    */
+    vector<uint64_t> head;
+    head.push_back( strings.size() );
+    uint64_t pos = 0;
+    for ( const auto& s : strings ){
+      head.push_back( pos );
+      pos += s.size();
+    }
+    head.push_back( pos );
+    string buffer( reinterpret_cast<const char*>( head.data() ),
+		   head.size() * sizeof(uint64_t) );
+    for ( const auto& s : strings ){
+      buffer += s;
+    }
+    add( name, buffer.data(), buffer.size() );
+  }
+
+  bool BundleWriter::write( const string& name ) const {
+    /// write all sections to file \e name
+    ofstream os( name, ios::binary );
+    if ( !os ){
+      cerr << "couldn't create bundle: " << name << endl;
+      return false;
+    }
+    bundle_header header;
+    memcpy( header.magic, BUNDLE_MAGIC, sizeof(header.magic) );
+    header.version = BUNDLE_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.word_size = sizeof(size_t);
+    header.num_sections = sections.size();
+    vector<bundle_entry> table( sections.size() );
+    size_t pos = aligned( sizeof(header) + table.size() * sizeof(bundle_entry) );
+    for ( size_t i=0; i < sections.size(); ++i ){
+      memset( table[i].name, 0, NAME_SIZE );
+      memcpy( table[i].name, sections[i].first.data(), sections[i].first.size() );
+      table[i].offset = pos;
+      table[i].size = sections[i].second.size();
+      pos = aligned( pos + table[i].size );
+    }
+    os.write( reinterpret_cast<const char*>( &header ), sizeof(header) );
+    os.write( reinterpret_cast<const char*>( table.data() ),
+	      table.size() * sizeof(bundle_entry) );
+    size_t written = sizeof(header) + table.size() * sizeof(bundle_entry);
+    const string padding( BUNDLE_ALIGN, '\0' );
+    for ( size_t i=0; i < sections.size(); ++i ){
+      os.write( padding.data(), table[i].offset - written );
+      os.write( sections[i].second.data(), sections[i].second.size() );
+      written = table[i].offset + sections[i].second.size();
+    }
+    return os.good();
+  }
+
+  Bundle::~Bundle(){
+    if ( mapped ){
+      munmap( const_cast<char*>( data ), length );
+    }
+  }
+
+  bool Bundle::open( const string& name ){
+    /// map the bundle \e name into memory and check its header
+    int fd = ::open( name.c_str(), O_RDONLY );
+    if ( fd < 0 ){
+      cerr << "couldn't open bundle: " << name << endl;
+      return false;
+    }
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 || st.st_size < (off_t)sizeof(bundle_header) ){
+      cerr << name << " is not a valid bundle" << endl;
+      close( fd );
+      return false;
+    }
+    length = st.st_size;
+    void *p = mmap( 0, length, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( p == MAP_FAILED ){
+      cerr << "couldn't map bundle: " << name << endl;
+      return false;
+    }
+    data = static_cast<const char*>( p );
+    mapped = true;
+    const bundle_header *header = reinterpret_cast<const bundle_header*>( data );
+    if ( memcmp( header->magic, BUNDLE_MAGIC, sizeof(header->magic) ) != 0 ){
+      cerr << name << " is not a valid bundle" << endl;
+      return false;
+    }
+    if ( header->version != BUNDLE_VERSION ){
+      cerr << name << " has bundle version " << header->version
+	   << ", but we need version " << BUNDLE_VERSION << endl;
+      return false;
+    }
+    if ( header->byte_order != BYTE_ORDER_MARK
+	 || header->word_size != sizeof(size_t) ){
+      cerr << name << " was made on an incompatible machine" << endl;
+      return false;
+    }
+    size_t table_end = sizeof(bundle_header)
+      + header->num_sections * sizeof(bundle_entry);
+    if ( table_end > length ){
+      cerr << name << " is truncated" << endl;
+      return false;
+    }
+    const bundle_entry *table
+      = reinterpret_cast<const bundle_entry*>( data + sizeof(bundle_header) );
+    for ( size_t i=0; i < header->num_sections; ++i ){
+      if ( table[i].offset + table[i].size > length ){
+	cerr << name << " is truncated" << endl;
+	return false;
+      }
+      string sname( table[i].name, strnlen( table[i].name, NAME_SIZE ) );
+      sections[sname] = make_pair( table[i].offset, table[i].size );
+    }
+    return true;
+  }
+
+  bool Bundle::has( const string& name ) const {
+    return sections.find( name ) != sections.end();
+  }
+
+  const void *Bundle::section( const string& name, size_t& size ) const {
+    /// the data of section \e name, or 0 when there is no such section
+    const auto it = sections.find( name );
+    if ( it == sections.end() ){
+      size = 0;
+      return 0;
+    }
+    size = it->second.second;
+    return data + it->second.first;
+  }
+
+  bool Bundle::strings( const string& name, vector<string>& result ) const {
+    /// the list of strings in section \e name
+    result.clear();
+    size_t size = 0;
+    const char *p = static_cast<const char*>( section( name, size ) );
+    if ( !p || size < sizeof(uint64_t) ){
+      return false;
+    }
+    const uint64_t *head = reinterpret_cast<const uint64_t*>( p );
+    uint64_t count = head[0];
+    size_t text_start = ( count + 2 ) * sizeof(uint64_t);
+    if ( text_start > size || text_start + head[count+1] > size ){
+      return false;
+    }
+    const char *text = p + text_start;
+    result.reserve( count );
+    for ( uint64_t i=0; i < count; ++i ){
+      result.push_back( string( text + head[i+1], head[i+2] - head[i+1] ) );
+    }
+    return true;
+  }
+
+}
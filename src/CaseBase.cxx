@@ -0,0 +1,560 @@
+/*
+  Copyright (c) 1998 - 2026
+  CLST  - Radboud University
+  ILK   - Tilburg University
+  CLiPS - University of Antwerp
+
+  This file is part of mbt
+
+  mbt is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  mbt is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/mbt/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <map>
+#include <unordered_map>
+
+#include "mbt/Tagger.h"
+#include "mbt/CaseBase.h"
+
+namespace Tagger {
+  using namespace std;
+  using namespace icu;
+
+  const string CB_MAGIC = "MBT-CASEBASE";
+  const int CB_VERSION = 1;
+
+  bool write_case_base( const string& inst_name, const string& cb_name ){
+    /// merge the instances in \e inst_name and store them in \e cb_name
+    ifstream is( inst_name );
+    if ( !is ){
+      cerr << "couldn't open instances file: " << inst_name << endl;
+      return false;
+    }
+    unordered_map<string,size_t> key_index;
+    vector<string> keys;
+    vector<vector<pair<size_t,size_t>>> counts;
+    unordered_map<string,size_t> class_index;
+    vector<string> class_names;
+    size_t num_features = 0;
+    string line;
+    while ( getline( is, line ) ){
+      string::size_type end = line.find_last_not_of( " \t\r" );
+      if ( end == string::npos ){
+	continue;
+      }
+      string::size_type pos = line.find_last_of( " \t", end );
+      if ( pos == string::npos ){
+	cerr << "invalid instance: '" << line << "'" << endl;
+	return false;
+      }
+      string key = line.substr( 0, pos );
+      string cls = line.substr( pos+1, end-pos );
+      if ( num_features == 0 ){
+	istringstream ss( key );
+	string v;
+	while ( ss >> v ){
+	  ++num_features;
+	}
+      }
+      auto cit = class_index.find( cls );
+      size_t c;
+      if ( cit == class_index.end() ){
+	c = class_names.size();
+	class_index[cls] = c;
+	class_names.push_back( cls );
+      }
+      else {
+	c = cit->second;
+      }
+      auto kit = key_index.find( key );
+      size_t k;
+      if ( kit == key_index.end() ){
+	k = keys.size();
+	key_index[key] = k;
+	keys.push_back( key );
+	counts.resize( k+1 );
+      }
+      else {
+	k = kit->second;
+      }
+      auto& dist = counts[k];
+      auto it = dist.begin();
+      while ( it != dist.end() && it->first != c ){
+	++it;
+      }
+      if ( it == dist.end() ){
+	dist.push_back( make_pair( c, 1 ) );
+      }
+      else {
+	++it->second;
+      }
+    }
+    ofstream os( cb_name );
+    if ( !os ){
+      cerr << "couldn't create case base file: " << cb_name << endl;
+      return false;
+    }
+    os << CB_MAGIC << " " << CB_VERSION << "\n"
+       << "features " << num_features << "\n"
+       << "classes " << class_names.size();
+    for ( const auto& c : class_names ){
+      os << " " << c;
+    }
+    os << "\n";
+    for ( size_t k=0; k < keys.size(); ++k ){
+      auto& dist = counts[k];
+      sort( dist.begin(), dist.end() );
+      os << keys[k];
+      for ( const auto& d : dist ){
+	os << " " << d.first << ":" << d.second;
+      }
+      os << "\n";
+    }
+    return os.good();
+  }
+
+  bool CaseBase::read( const string& name, SymbolTable& symbols ){
+    /// read a compact case base file, as written by write_case_base()
+    /*!
+      All values and classes are added to \e symbols
+    */
+    ifstream is( name );
+    if ( !is ){
+      cerr << "couldn't open case base file: " << name << endl;
+      return false;
+    }
+    string word;
+    int version = 0;
+    if ( !( is >> word >> version ) || word != CB_MAGIC || version != CB_VERSION ){
+      cerr << name << " is not a valid case base file" << endl;
+      return false;
+    }
+    size_t num_classes = 0;
+    if ( !( is >> word >> num_features ) || word != "features"
+	 || !( is >> word >> num_classes ) || word != "classes" ){
+      cerr << name << " has an invalid header" << endl;
+      return false;
+    }
+    classes.clear();
+    for ( size_t c=0; c < num_classes; ++c ){
+      is >> word;
+      classes.push_back( symbols.hash( TiCC::UnicodeFromUTF8( word ) ) );
+    }
+    values.clear();
+    dist.clear();
+    dist_begin.clear();
+    string line;
+    getline( is, line );
+    while ( getline( is, line ) ){
+      istringstream ss( line );
+      size_t f = 0;
+      while ( f < num_features && ss >> word ){
+	values.push_back( symbols.hash( TiCC::UnicodeFromUTF8( word ) ) );
+	++f;
+      }
+      if ( f == 0 ){
+	continue;
+      }
+      if ( f != num_features ){
+	cerr << name << ": invalid instance '" << line << "'" << endl;
+	return false;
+      }
+      dist_begin.push_back( dist.size() );
+      while ( ss >> word ){
+	string::size_type pos = word.rfind( ':' );
+	size_t c = 0;
+	double count = 0;
+	if ( pos == string::npos
+	     || !TiCC::stringTo<size_t>( word.substr( 0, pos ), c )
+	     || !TiCC::stringTo<double>( word.substr( pos+1 ), count )
+	     || c >= num_classes ){
+	  cerr << name << ": invalid instance '" << line << "'" << endl;
+	  return false;
+	}
+	dist.push_back( make_pair( c, count ) );
+      }
+    }
+    dist_begin.push_back( dist.size() );
+    return true;
+  }
+
+  double CaseBase::weight( size_t i ) const {
+    /// the number of training instances merged into instance \e i
+    double result = 0.0;
+    for ( size_t d=dist_begin[i]; d < dist_begin[i+1]; ++d ){
+      result += dist[d].second;
+    }
+    return result;
+  }
+
+  void CaseBase::global_counts( vector<double>& result ) const {
+    /// the count of every class over all the instances
+    result.assign( classes.size(), 0.0 );
+    for ( const auto& d : dist ){
+      result[d.first] += d.second;
+    }
+  }
+
+  double entropy( const map<int,double>& counts, double total ){
+    double result = 0.0;
+    for ( const auto& it : counts ){
+      if ( it.second > 0 ){
+	double p = it.second / total;
+	result -= p * log2( p );
+      }
+    }
+    return result;
+  }
+
+  void CaseBase::gain_ratios( vector<double>& result ) const {
+    /// compute the gain ratio of every feature, like Timbl does
+    result.assign( num_features, 0.0 );
+    map<int,double> class_counts;
+    double total = 0.0;
+    for ( const auto& d : dist ){
+      class_counts[d.first] += d.second;
+      total += d.second;
+    }
+    if ( total == 0 ){
+      return;
+    }
+    double class_entropy = entropy( class_counts, total );
+    for ( size_t f=0; f < num_features; ++f ){
+      unordered_map<int,map<int,double>> value_counts;
+      for ( size_t i=0; i < size(); ++i ){
+	auto& vc = value_counts[value(i,f)];
+	for ( size_t d=dist_begin[i]; d < dist_begin[i+1]; ++d ){
+	  vc[dist[d].first] += dist[d].second;
+	}
+      }
+      double cond_entropy = 0.0;
+      double split_info = 0.0;
+      for ( const auto& it : value_counts ){
+	double n = 0.0;
+	for ( const auto& c : it.second ){
+	  n += c.second;
+	}
+	double p = n / total;
+	cond_entropy += p * entropy( it.second, n );
+	split_info -= p * log2( p );
+      }
+      if ( split_info > 0 ){
+	result[f] = ( class_entropy - cond_entropy ) / split_info;
+      }
+    }
+  }
+
+  void fill_classification( const pair<int,double> *entries,
+			    size_t num,
+			    const vector<int>& classes,
+			    size_t best,
+			    bool with_string,
+			    SymbolTable& symbols,
+			    Classification& cl ){
+    /// turn a distribution over class numbers into a Classification,
+    /// with entry \e best as the answer
+    cl.clear();
+    if ( num == 0 ){
+      return;
+    }
+    double total = 0.0;
+    cl.distribution.reserve( num );
+    for ( size_t i=0; i < num; ++i ){
+      const auto& e = entries[i];
+      total += e.second;
+      cl.distribution.push_back( make_pair( classes[e.first], e.second ) );
+    }
+    cl.answer = classes[entries[best].first];
+    cl.confidence = entries[best].second / total;
+    if ( with_string ){
+      ostringstream os;
+      os << "{ ";
+      for ( size_t i=0; i < num; ++i ){
+	if ( i > 0 ){
+	  os << ", ";
+	}
+	os << symbols.reverse_lookup( classes[entries[i].first] )
+	   << " " << entries[i].second;
+      }
+      os << " }";
+      cl.dist_string = os.str();
+    }
+  }
+
+  class tree_reader {
+    /// reads the tree part of a hashed Timbl instance base file:
+    ///   node  := '(' class [ dist ] [ '[' value node { ',' value node } ']' ] ')'
+    ///   dist  := '{' class count [ weight ] { ',' class count [ weight ] } '}'
+    /// where the classes and the values are numbers in the hash tables
+    /// that precede the tree.
+  public:
+    class parsed {
+    public:
+      int value;
+      int answer;
+      vector<pair<int,double>> dist;
+      vector<size_t> children;
+    };
+    tree_reader( istream& in, size_t nc, size_t nf ):
+      is( in ), num_classes( nc ), num_values( nf ){};
+    bool node( int value, vector<parsed>& result );
+  private:
+    bool expect( char c ){
+      char got = 0;
+      return ( is >> got ) && got == c;
+    };
+    int peek(){
+      is >> ws;
+      return is.peek();
+    };
+    istream& is;
+    size_t num_classes;
+    size_t num_values;
+  };
+
+  bool tree_reader::node( int value, vector<parsed>& result ){
+    size_t cls = 0;
+    if ( !expect( '(' ) || !( is >> cls ) || cls == 0 || cls > num_classes ){
+      return false;
+    }
+    size_t me = result.size();
+    result.push_back( parsed() );
+    result[me].value = value;
+    result[me].answer = cls - 1;
+    if ( peek() == '{' ){
+      is.get();
+      while ( peek() != '}' ){
+	double count = 0;
+	if ( !( is >> cls >> count ) || cls == 0 || cls > num_classes ){
+	  return false;
+	}
+	result[me].dist.push_back( make_pair( cls - 1, count ) );
+	int c = peek();
+	if ( c != ',' && c != '}' ){
+	  double weight;
+	  if ( !( is >> weight ) ){
+	    return false;
+	  }
+	  c = peek();
+	}
+	if ( c == ',' ){
+	  is.get();
+	}
+	else if ( c != '}' ){
+	  return false;
+	}
+      }
+      is.get();
+      sort( result[me].dist.begin(), result[me].dist.end() );
+    }
+    if ( peek() == '[' ){
+      is.get();
+      while ( true ){
+	size_t v = 0;
+	if ( !( is >> v ) || v == 0 || v > num_values ){
+	  return false;
+	}
+	result[me].children.push_back( result.size() );
+	if ( !node( v - 1, result ) ){
+	  return false;
+	}
+	if ( peek() != ',' ){
+	  break;
+	}
+	is.get();
+      }
+      if ( !expect( ']' ) ){
+	return false;
+      }
+    }
+    return expect( ')' );
+  }
+
+  bool read_hash( istream& is,
+		  const string& until,
+		  SymbolTable& symbols,
+		  vector<int>& result ){
+    /// read the "<index> <string>" lines of a Timbl hash table
+    string line;
+    while ( getline( is, line ) ){
+      if ( line == until || ( until.empty() && line.empty() ) ){
+	return true;
+      }
+      istringstream ss( line );
+      size_t index = 0;
+      string value;
+      if ( !( ss >> index >> value ) || index != result.size()+1 ){
+	return false;
+      }
+      result.push_back( symbols.hash( TiCC::UnicodeFromUTF8( value ) ) );
+    }
+    return false;
+  }
+
+  bool FlatIGTree::read( const string& name, SymbolTable& symbols ){
+    /// read the IGTREE that Timbl stored in \e name
+    /*!
+      The file must be written with hashed trees (Timbl's default) and
+      with the distributions kept (+D). The tree is taken over as is, so
+      Timbl's feature order, pruning and default classes are ours too.
+      All values and classes are added to \e symbols
+    */
+    ifstream is( name );
+    if ( !is ){
+      cerr << "couldn't open instance base file: " << name << endl;
+      return false;
+    }
+    order.clear();
+    bool hashed = false;
+    string line;
+    while ( getline( is, line ) ){
+      if ( line.empty() ){
+	continue;
+      }
+      if ( line[0] != '#' ){
+	break;
+      }
+      if ( line.find( "# Permutation:" ) == 0 ){
+	istringstream ss( line.substr( line.find( '<' ) + 1 ) );
+	size_t f;
+	char sep;
+	while ( ss >> f ){
+	  order.push_back( f - 1 );
+	  ss >> sep;
+	}
+      }
+      else if ( line.find( "# Version" ) == 0 ){
+	hashed = line.find( "Hashed" ) != string::npos;
+      }
+    }
+    if ( !hashed || order.empty() || line != "Classes" ){
+      cerr << name << " is not a hashed Timbl instance base" << endl;
+      return false;
+    }
+    classes.clear();
+    vector<int> values;
+    if ( !read_hash( is, "Features", symbols, classes )
+	 || !read_hash( is, "", symbols, values ) ){
+      cerr << name << " holds invalid hash tables" << endl;
+      return false;
+    }
+    vector<tree_reader::parsed> tree;
+    tree_reader reader( is, classes.size(), values.size() );
+    if ( !reader.node( 0, tree ) ){
+      cerr << name << ": can't read the tree, near node "
+	   << tree.size() << endl;
+      return false;
+    }
+    for ( const auto& p : tree ){
+      if ( p.dist.empty() ){
+	cerr << name << " holds no distributions, it must be made with +D"
+	     << endl;
+	return false;
+      }
+    }
+    // breadth first, so the children of every node are adjacent, and
+    // sorted on our own symbol numbers
+    nodes.clear();
+    dists.clear();
+    vector<size_t> queue( 1, 0 );
+    for ( size_t q=0; q < queue.size(); ++q ){
+      tree_reader::parsed& p = tree[queue[q]];
+      node n;
+      n.value = q == 0 ? 0 : values[p.value];
+      n.dist_offset = dists.size();
+      n.dist_size = p.dist.size();
+      n.answer = 0;
+      for ( size_t d=0; d < p.dist.size(); ++d ){
+	if ( p.dist[d].first == p.answer ){
+	  n.answer = d;
+	}
+	dists.push_back( p.dist[d] );
+      }
+      sort( p.children.begin(), p.children.end(),
+	    [&]( size_t a, size_t b ){
+	      return values[tree[a].value] < values[tree[b].value]; } );
+      n.first_child = queue.size();
+      n.num_children = p.children.size();
+      queue.insert( queue.end(), p.children.begin(), p.children.end() );
+      nodes.push_back( n );
+    }
+    node_data.set( nodes );
+    dist_data.set( dists );
+    return true;
+  }
+
+  void FlatIGTree::save( BundleWriter& bw, const string& prefix ) const {
+    /// add the tree to a bundle, in sections starting with \e prefix
+    bw.add( prefix + ".order", order );
+    bw.add( prefix + ".classes", classes );
+    bw.add( prefix + ".nodes", node_data.data(), node_data.size() * sizeof(node) );
+    bw.add( prefix + ".dists", dist_data.data(),
+	    dist_data.size() * sizeof(pair<int,double>) );
+  }
+
+  bool FlatIGTree::attach( const Bundle& bundle, const string& prefix ){
+    /// use the tree stored in \e bundle under \e prefix
+    /*!
+      The nodes and distributions stay in the bundle, so \e bundle must
+      outlive the tree.
+    */
+    size_t n = 0;
+    const size_t *o = bundle.array<size_t>( prefix + ".order", n );
+    order.assign( o, o+n );
+    const int *c = bundle.array<int>( prefix + ".classes", n );
+    classes.assign( c, c+n );
+    const node *nd = bundle.array<node>( prefix + ".nodes", n );
+    node_data.set( nd, n );
+    const pair<int,double> *d = bundle.array<pair<int,double>>( prefix + ".dists", n );
+    dist_data.set( d, n );
+    return !node_data.empty();
+  }
+
+  void FlatIGTree::classify( const vector<int>& pattern,
+			     bool with_string,
+			     SymbolTable& symbols,
+			     Classification& cl ) const {
+    /// classify \e pattern, by following the matching values as deep as
+    /// possible into the tree. The deepest node gives the outcome: its
+    /// default class and its distribution, like Timbl's IGTREE.
+    size_t n = 0;
+    for ( const auto& f : order ){
+      const node& cur = node_data[n];
+      const node *lo = node_data.data() + cur.first_child;
+      const node *hi = lo + cur.num_children;
+      int v = pattern[f];
+      const node *hit = lower_bound( lo, hi, v,
+				     []( const node& a, int b ){
+				       return a.value < b; } );
+      if ( hit == hi || hit->value != v ){
+	break;
+      }
+      n = hit - node_data.data();
+    }
+    const node& found = node_data[n];
+    fill_classification( dist_data.data() + found.dist_offset, found.dist_size,
+			 classes, found.answer, with_string, symbols, cl );
+  }
+
+}
@@ -0,0 +1,89 @@
+/*
+  Copyright (c) 1998 - 2026
+  CLST  - Radboud University
+  ILK   - Tilburg University
+  CLiPS - University of Antwerp
+
+  This file is part of mbt
+
+  mbt is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  mbt is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/mbt/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+#include "mbt/ClassifyCache.h"
+
+namespace Tagger {
+  using namespace std;
+
+  ClassifyCache::ClassifyCache( size_t size ):
+    max_size( size ),
+    num_hits(0),
+    num_misses(0)
+  {
+    index.reserve( size );
+  }
+
+  size_t ClassifyCache::key_hash::operator()( const vector<int>& key ) const {
+    // FNV-1a over the symbol numbers
+    size_t h = 14695981039346656037ULL;
+    for ( const auto& k : key ){
+      h ^= static_cast<unsigned int>(k);
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+  bool ClassifyCache::lookup( const vector<int>& key, Classification& cl ){
+    /// find the classification for \e key
+    /*!
+      \return true, with the result in \e cl, when \e key is cached
+    */
+    const auto it = index.find( key );
+    if ( it == index.end() ){
+      ++num_misses;
+      return false;
+    }
+    ++num_hits;
+    // move it to the front
+    entries.splice( entries.begin(), entries, it->second );
+    cl = it->second->second;
+    return true;
+  }
+
+  void ClassifyCache::store( const vector<int>& key,
+			     const Classification& cl ){
+    /// add the classification \e cl for \e key
+    if ( max_size == 0 || index.find( key ) != index.end() ){
+      return;
+    }
+    if ( index.size() >= max_size ){
+      // drop the least recently used
+      index.erase( entries.back().first );
+      entries.pop_back();
+    }
+    entries.push_front( make_pair( key, cl ) );
+    index[key] = entries.begin();
+  }
+
+  void ClassifyCache::add_counts( const ClassifyCache& other ){
+    /// add the hit and miss counts of \e other to ours
+    num_hits += other.num_hits;
+    num_misses += other.num_misses;
+  }
+
+}
@@ -29,6 +29,7 @@
 #include <vector>
 #include <map>
 #include <fstream>
+#include <sstream>
 #include <iostream>
 #include <cerrno>
 #include <cstdio>
@@ -46,15 +47,19 @@
 #include "mbt/Sentence.h"
 #include "mbt/Logging.h"
 #include "mbt/Tagger.h"
+#include "mbt/CaseBase.h"
 
 #if defined(HAVE_PTHREAD)
 #include <pthread.h>
 #endif
 
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
+
 namespace Tagger {
   using namespace std;
   using namespace icu;
-  using namespace Hash;
   using namespace Timbl;
 
   const string UNKSTR   = "UNKNOWN";
@@ -86,6 +91,8 @@ namespace Tagger {
     }
   };
 
+  const size_t LEX_BLOCK_SIZE = 100000; // lines counted in parallel
+
   bool TaggerClass::create_lexicons(){
     TagLex TaggedLexicon;
     ifstream lex_file;
@@ -106,12 +113,52 @@ namespace Tagger {
       return false;
     }
     map<UnicodeString,unsigned int> TagList;
-    UnicodeString buffer;
-    while ( TiCC::getline( lex_file, buffer ) ){
-      UnicodeString word, tag;
-      if ( split_special( buffer, word, tag ) ){
-	TaggedLexicon.Store( word, tag );
-	TagList[tag]++;
+    // the lines are read in blocks, and every block is divided over a
+    // number of partial lexicons, which are filled in parallel. In the
+    // end, the partial results are merged.
+    size_t parts = 1;
+#ifdef HAVE_OPENMP
+    parts = omp_get_max_threads();
+#endif
+    vector<TagLex*> part_lex( parts );
+    vector<map<UnicodeString,unsigned int>> part_tags( parts );
+    for ( size_t p=1; p < parts; ++p ){
+      part_lex[p] = new TagLex();
+    }
+    part_lex[0] = &TaggedLexicon;
+    vector<UnicodeString> lines;
+    lines.reserve( LEX_BLOCK_SIZE );
+    bool more = true;
+    while ( more ){
+      UnicodeString buffer;
+      while ( lines.size() < LEX_BLOCK_SIZE ){
+	if ( !TiCC::getline( lex_file, buffer ) ){
+	  more = false;
+	  break;
+	}
+	lines.push_back( buffer );
+      }
+#pragma omp parallel for
+      for ( long p=0; p < (long)parts; ++p ){
+	size_t begin = ( lines.size() * p ) / parts;
+	size_t end = ( lines.size() * (p+1) ) / parts;
+	for ( size_t i=begin; i < end; ++i ){
+	  UnicodeString word, tag;
+	  if ( split_special( lines[i], word, tag ) ){
+	    part_lex[p]->Store( word, tag );
+	    part_tags[p][tag]++;
+	  }
+	}
+      }
+      lines.clear();
+    }
+    for ( size_t p=1; p < parts; ++p ){
+      TaggedLexicon.Merge( *part_lex[p] );
+      delete part_lex[p];
+    }
+    for ( const auto& tags : part_tags ){
+      for ( const auto& it : tags ){
+	TagList[it.first] += it.second;
       }
     }
     vector<TagInfo *>TagVect = TaggedLexicon.CreateSortedVector();
@@ -129,8 +176,9 @@ namespace Tagger {
       cerr << "couldn't create lexiconfile " << LexFileName << endl;
       return false;
     }
-    for ( auto const& tv : TagVect ){
-      ProcessTags( tv );
+#pragma omp parallel for
+    for ( long i=0; i < (long)TagVect.size(); ++i ){
+      ProcessTags( TagVect[i] );
     }
     if ( (out_file.open( MTLexFileName, ios::out ),
 	  out_file.good() ) ){
@@ -217,18 +265,52 @@ namespace Tagger {
     return true;
   }
 
+  int TaggerClass::window_sentence( sentence& mySentence,
+				    bool do_known,
+				    ostream& outfile ){
+    // write the instances for all words of mySentence to outfile
+    // init_windowing() must have been called on mySentence
+    MatchAction Action = do_known ? MakeKnown : MakeUnknown;
+    vector<int> TestPat;
+    int no_words = 0;
+    int swcn = 0;
+    vector<int> dummy(1,0);
+    while( mySentence.nextpat( Action, TestPat,
+			       *kwordlist, TheLex,
+			       swcn, dummy ) ){
+      bool skip = false;
+      if ( DoNpax && !do_known ){
+	if ( (uwordlist->lookup( mySentence.getword(swcn))) == 0 ){
+	  skip = true;
+	}
+      }
+      if ( !skip ){
+	for ( const auto& pat: TestPat ){
+	  outfile << indexlex( pat, TheLex ) << " ";
+	}
+      }
+      int thisTagCode = TheLex.hash( mySentence.gettag(swcn) );
+      if ( !skip ){
+	for ( auto const& it : mySentence.getEnrichments(swcn) ){
+	  outfile << it << " ";
+	}
+	outfile << mySentence.gettag( swcn ) << '\n';
+      }
+      mySentence.assign_tag(thisTagCode, swcn );
+      ++swcn;
+      ++no_words;
+    }
+    return no_words;
+  }
+
   int TaggerClass::makedataset( istream& infile, bool do_known ){
     int no_words=0;
     ofstream outfile;
-    MatchAction Action;
-    vector<int> TestPat;
     if ( do_known ){
       outfile.open( K_option_name, ios::trunc | ios::out );
-      Action = MakeKnown;
     }
     else {
       outfile.open( U_option_name, ios::trunc | ios::out );
-      Action = MakeUnknown;
     }
     // loop as long as you get sentences
     //
@@ -258,37 +340,7 @@ namespace Tagger {
 	// we initialize the windowing procedure, this entails lexical lookup
 	// of the words in the dictionary and the values
 	// of the features are stored in the testpattern
-	int swcn = 0;
-	vector<int> dummy(1,0);
-	while( mySentence.nextpat( Action, TestPat,
-				   *kwordlist, TheLex,
-				   swcn, dummy ) ){
-	  bool skip = false;
-	  if ( DoNpax && !do_known ){
-	    if ( (uwordlist->lookup( mySentence.getword(swcn))) == 0 ){
-	      skip = true;
-	    }
-	  }
-	  if ( !skip ){
-	    for ( const auto& pat: TestPat ){
-	      outfile << indexlex( pat, TheLex ) << " ";
-	    }
-	  }
-	  int thisTagCode = -1;
-#pragma omp critical (hasher)
-	  {
-	    thisTagCode = TheLex.hash( mySentence.gettag(swcn) );
-	  }
-	  if ( !skip ){
-	    for ( auto const& it : mySentence.getEnrichments(swcn) ){
-	      outfile << it << " ";
-	    }
-	    outfile << mySentence.gettag( swcn ) << '\n';
-	  }
-	  mySentence.assign_tag(thisTagCode, swcn );
-	  ++swcn;
-	  ++no_words;
-	}
+	no_words += window_sentence( mySentence, do_known, outfile );
       }
     }
 //      default_cout << "Output written to ";
@@ -299,18 +351,145 @@ namespace Tagger {
     return no_words;
   }
 
+  const size_t CHUNK_SIZE = 1024; // sentences windowed in parallel
+
+  int TaggerClass::makedatasets( istream& infile ){
+    /// read and window the training data once, writing both the known
+    /// and the unknown words instances.
+    /*!
+      \return the number of words processed
+
+      The data is read in chunks of CHUNK_SIZE sentences. The sentences
+      of a chunk are windowed in parallel, each into its own buffers,
+      which are then written in input order. So the instance files are
+      the same as those of a sequential run.
+    */
+    int no_words=0;
+    ofstream k_outfile;
+    ofstream u_outfile;
+    if ( knowntemplateflag ){
+      k_outfile.open( K_option_name, ios::trunc | ios::out );
+    }
+    if ( unknowntemplateflag ){
+      u_outfile.open( U_option_name, ios::trunc | ios::out );
+    }
+    int HartBeat = 0;
+    size_t line_cnt = 0;
+    sentence mySentence( Ktemplate, Utemplate );
+    vector<sentence*> chunk;
+    chunk.reserve( CHUNK_SIZE );
+    vector<string> k_parts( CHUNK_SIZE );
+    vector<string> u_parts( CHUNK_SIZE );
+    vector<int> counts( CHUNK_SIZE );
+    bool more = true;
+    while ( more ){
+      while ( chunk.size() < CHUNK_SIZE ){
+	if ( !mySentence.read( infile, input_kind, EosMark,
+			       Separators, line_cnt ) ){
+	  more = false;
+	  break;
+	}
+	if ( mySentence.size() == 0 ){
+	  continue;
+	}
+	if ( mySentence.getword(0) == EosMark ){
+	  // only possible for ENRICHED!
+	  continue;
+	}
+	if ( ++HartBeat % 100 == 0 ) {
+	  COUT << "+";
+	  default_cout.flush();
+	}
+	sentence *sent = new sentence( Ktemplate, Utemplate );
+	sent->take_over( mySentence );
+	chunk.push_back( sent );
+      }
+      const long n = chunk.size();
+#pragma omp parallel for schedule(dynamic,16)
+      for ( long i=0; i < n; ++i ){
+	sentence *sent = chunk[i];
+	counts[i] = 0;
+	k_parts[i].clear();
+	u_parts[i].clear();
+	if ( sent->init_windowing( *MT_lexicon, TheLex ) ) {
+	  int nw = 0;
+	  if ( knowntemplateflag ){
+	    ostringstream os;
+	    nw = window_sentence( *sent, true, os );
+	    k_parts[i] = os.str();
+	  }
+	  if ( unknowntemplateflag ){
+	    if ( knowntemplateflag ){
+	      // undo the tags assigned in the known pass, so a 'd' slot right
+	      // of the focus sees the same values as in a separate run
+	      for ( size_t j=0; j < sent->size(); ++j ){
+		sent->assign_tag( -1, j );
+	      }
+	    }
+	    ostringstream os;
+	    nw = window_sentence( *sent, false, os );
+	    u_parts[i] = os.str();
+	  }
+	  counts[i] = nw;
+	}
+      }
+      for ( long i=0; i < n; ++i ){
+	if ( knowntemplateflag ){
+	  k_outfile << k_parts[i];
+	}
+	if ( unknowntemplateflag ){
+	  u_outfile << u_parts[i];
+	}
+	no_words += counts[i];
+	delete chunk[i];
+      }
+      chunk.clear();
+    }
+    return no_words;
+  }
+
+  bool TaggerClass::learn_case_base( bool do_known ){
+    /// train a Timbl case base on the known or unknown words instances
+    /// and save it
+    const string opts = ( do_known ? knownstr : unknownstr ) + commonstr;
+    const string& inst_name = do_known ? K_option_name : U_option_name;
+    const string& tree_name = do_known ? KnownTreeName : UnknownTreeName;
+    const string& weights_name = do_known ? kwf : uwf;
+    TimblAPI *tree = new TimblAPI( opts );
+    if ( !tree->Valid() ){
+      cerr << "unable to create Timbl(" << opts << ") for "
+	   << ( do_known ? "Known" : "Unknown" ) << " words." << endl;
+      delete tree;
+      return false;
+    }
+    COUT << "    Algorithm = " << to_string(tree->Algo()) << endl;
+    COUT << "    Creating case base: " << tree_name << endl;
+    tree->Learn( inst_name );
+    tree->WriteInstanceBase( tree_name );
+    if ( !weights_name.empty() ){
+      tree->SaveWeights( weights_name );
+    }
+    delete tree;
+    if ( write_native && !do_known ){
+      // a compact copy of the instances, for mbt --native-unknown
+      const string cb_name = tree_name + ".cb";
+      COUT << "    Creating compact case base: " << cb_name << endl;
+      if ( !write_case_base( inst_name, cb_name ) ){
+	return false;
+      }
+    }
+    if ( !KeepIntermediateFiles ){
+      remove( inst_name.c_str() );
+      COUT << "    Deleted intermediate file: " << inst_name << endl;
+    }
+    return true;
+  }
+
   int TaggerClass::CreateKnown(){
     int nwords = 0;
     if ( knowntemplateflag ){
       COUT << "  Create known words case base,"
 	   << "   Timbl options: '" << knownstr + commonstr << "'" << endl;
-      TimblAPI *Ktree = new TimblAPI( knownstr + commonstr );
-      if ( !Ktree->Valid() ){
-	cerr << "unable to create Timbl(" << knownstr + commonstr
-	     << ") for Known words." << endl;
-	return -1; // signal a failure
-      }
-      COUT << "    Algorithm = " << to_string(Ktree->Algo()) << endl;
       if ( !piped_input ){
 	string inname = TestFilePath + TestFileName;
 	ifstream infile( inname, ios::in );
@@ -326,17 +505,9 @@ namespace Tagger {
 	COUT << "Processing data from the standard input" << endl;
 	nwords = makedataset( cin, true );
       }
-      COUT << endl << "    Creating case base: " << KnownTreeName << endl;
-      Ktree->Learn( K_option_name );
-      //      UKtree->ShowSettings( default_cout );
-      Ktree->WriteInstanceBase( KnownTreeName );
-      if ( !kwf.empty() ){
-	Ktree->SaveWeights( kwf );
-      }
-      delete Ktree;
-      if ( !KeepIntermediateFiles ){
-	remove(K_option_name.c_str());
-	COUT << "    Deleted intermediate file: " << K_option_name << endl;
+      COUT << endl;
+      if ( !learn_case_base( true ) ){
+	return -1; // signal a failure
       }
     }
     return nwords;
@@ -347,13 +518,6 @@ namespace Tagger {
     if ( unknowntemplateflag ){
       COUT << "  Create unknown words case base,"
 	   << " Timbl options: '" << unknownstr + commonstr << "'" << endl;
-      TimblAPI *UKtree = new TimblAPI( unknownstr + commonstr );
-      if ( !UKtree->Valid() ){
-	cerr << "unable to create Timbl(" << unknownstr + commonstr
-	     << ") for Unknown words." << endl;
-	return -1; // signal a failure
-      }
-      COUT << "    Algorithm = " << to_string(UKtree->Algo()) << endl;
       if ( !piped_input ){
 	string inname = TestFilePath + TestFileName;
 	ifstream infile( inname, ios::in );
@@ -361,27 +525,40 @@ namespace Tagger {
 	  cerr << "Cannot read from " << inname << endl;
 	  return 0;
 	}
-	// COUT << "    Processing data from the file " << inname << "...";
-	// default_cout.flush();
 	nwords = makedataset( infile, false );
       }
       else {
 	COUT << "Processing data from the standard input" << endl;
 	nwords = makedataset( cin, false );
       }
-      COUT << endl << "    Creating case base: " << UnknownTreeName << endl;
-      UKtree->Learn( U_option_name );
-      //      UKtree->ShowSettings( COUT );
-      UKtree->WriteInstanceBase( UnknownTreeName );
-      if ( !uwf.empty() ){
-	UKtree->SaveWeights( uwf );
+      COUT << endl;
+      if ( !learn_case_base( false ) ){
+	return -1; // signal a failure
       }
-      delete UKtree;
-      if ( !KeepIntermediateFiles ){
-	remove(U_option_name.c_str());
-	COUT << "    Deleted intermediate file: " << U_option_name << endl;
+    }
+    return nwords;
+  }
+
+  int TaggerClass::CreateInstances(){
+    /// create the instance files for both case bases in one pass over
+    /// the training data
+    int nwords = 0;
+    if ( !piped_input ){
+      string inname = TestFilePath + TestFileName;
+      ifstream infile( inname, ios::in );
+      if ( infile.bad() ){
+	cerr << "Cannot read from " << inname << endl;
+	return -1;
       }
+      COUT << "  Processing data from the file " << inname << "...";
+      default_cout.flush();
+      nwords = makedatasets( infile );
+    }
+    else {
+      COUT << "Processing data from the standard input" << endl;
+      nwords = makedatasets( cin );
     }
+    COUT << endl;
     return nwords;
   }
 
@@ -409,6 +586,9 @@ namespace Tagger {
       out_file << "P " << UtmplStr << endl;
       out_file << "O " << Timbl_Options << endl;
       out_file << "L " << TopNFileBaseName << endl;
+      if ( write_bundle ){
+	out_file << "b " << BundleBaseName << endl;
+      }
       out_file.close();
       COUT << endl << "  Created settings file '"
 			 << SettingsFileName << "'" << endl;
@@ -416,10 +596,43 @@ namespace Tagger {
     return true;
   }
 
+  bool TaggerClass::CreateBundle(){
+    /// compile the tagger we just made into a model bundle
+    /*!
+      The bundle gets exactly what mbt would build from the text files,
+      so we set up a tagger from the new settings file, like mbt does.
+    */
+    TaggerClass bundler;
+    bundler.SettingsFileName = SettingsFileName;
+    string::size_type lastSlash = SettingsFileName.rfind('/');
+    if ( lastSlash != string::npos ){
+      bundler.SettingsFilePath = SettingsFileName.substr( 0, lastSlash+1 );
+    }
+    if ( !bundler.readsettings( bundler.SettingsFileName )
+	 || !bundler.set_default_filenames() ){
+      cerr << "Cannot read settingsfile " << SettingsFileName << endl;
+      return false;
+    }
+    // the known words tree is taken from Timbl's own file, but the
+    // unknown words index needs the compact case base of --native
+    bundler.native_known = true;
+    bundler.native_unknown = write_native;
+    if ( !write_native ){
+      cerr << "Warning: --bundle without --native, the bundle gets no "
+	   << "unknown words index, so mbt --native-unknown can't be used "
+	   << "with it" << endl;
+    }
+    bundler.read_lexicon( bundler.MTLexFileName );
+    bundler.read_listfile( bundler.TopNFileName, bundler.kwordlist );
+    bundler.fill_base_lex();
+    COUT << "  Creating model bundle: " << bundler.BundleName << endl;
+    return bundler.save_bundle( bundler.BundleName );
+  }
+
   //**** stuff to process commandline options *****************************
 
   const string mbt_create_short = "hV%:d:e:E:k:K:l:L:m:M:n:o:O:p:P:r:s:t:T:u:U:XD:";
-  const string mbt_create_long = "version,tabbed";
+  const string mbt_create_long = "version,tabbed,native,bundle";
 
   bool TaggerClass::parse_create_args( TiCC::CL_Options& opts ){
     string value;
@@ -434,6 +647,12 @@ namespace Tagger {
       EosMark = TiCC::UnicodeFromUTF8(value);
       cout << "  Sentence delimiter set to '" << EosMark << "'" << endl;
     }
+    if ( opts.extract( "native" ) ){
+      write_native = true;
+    }
+    if ( opts.extract( "bundle" ) ){
+      write_bundle = true;
+    }
     if ( opts.extract( "tabbed" ) ){
       Separators = "\t";
     }
@@ -568,6 +787,10 @@ namespace Tagger {
 	 << "\t-E <enriched tagged training corpus file> \n"
 	 << "\t-T <tagged training corpus file> \n"
 	 << "\t--tabbed ONLY use tabs as separator in TAGGED input. (default is all whitespace)\n"
+	 << "\t--native also store the unknown words instances in a compact\n"
+	 << "\t   form, for use with mbt --native-unknown\n"
+	 << "\t--bundle also compile the tagger into one binary bundle, which\n"
+	 << "\t   mbt maps into memory at startup\n"
 	 << "\t-O\"Timbl options\" (Note: NO SPACE between O and \"!!!)\n"
 	 << "\t   <options>   options to use for both Known and Unknown Words Case Base\n"
 	 << "\t   K: <options>   options to use for Known Words Case Base\n"
@@ -610,30 +833,51 @@ namespace Tagger {
     }
     tagger.set_default_filenames();
     tagger.InitLearning();
-    // process the test material
-    // and do the timing
-    int kwords = 0;
-    int uwords = 0;
+    // process the training material once, for both case bases
+    int nwords = tagger.CreateInstances();
+    if ( nwords < 0 ){
+      cerr << "Generating a tagger failed" << endl;
+      return -1;
+    }
+    // and learn them in parallel
+    bool k_ok = true;
+    bool u_ok = true;
 #pragma omp parallel sections
     {
 #pragma omp section
       {
-	kwords = tagger.CreateKnown();
+	if ( tagger.knowntemplateflag ){
+	  COUT << "  Create known words case base,"
+	       << "   Timbl options: '"
+	       << tagger.knownstr + tagger.commonstr << "'" << endl;
+	  k_ok = tagger.learn_case_base( true );
+	}
       }
 #pragma omp section
       {
-	uwords = tagger.CreateUnknown();
+	if ( tagger.unknowntemplateflag ){
+	  COUT << "  Create unknown words case base,"
+	       << " Timbl options: '"
+	       << tagger.unknownstr + tagger.commonstr << "'" << endl;
+	  u_ok = tagger.learn_case_base( false );
+	}
       }
     }
-    if ( kwords < 0 || uwords < 0 ){
+    if ( !k_ok || !u_ok ){
       cerr << "Generating a tagger failed" << endl;
       return -1;
     }
-    COUT << "      ready: " << kwords << " words processed."
+    int kwords = tagger.knowntemplateflag ? nwords : 0;
+    int uwords = tagger.unknowntemplateflag ? nwords : 0;
+    COUT << "      ready: " << nwords << " words processed."
 	 << endl;
     if ( !tagger.CreateSettingsFile() ){
       return -1;
     }
+    if ( tagger.write_bundle && !tagger.CreateBundle() ){
+      cerr << "Creating the model bundle failed" << endl;
+      return -1;
+    }
     return kwords + uwords;
   }
 
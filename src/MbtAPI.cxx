@@ -30,6 +30,7 @@
 #include <ctime>
 #include <cstdlib>
 #include <stdexcept>
+#include <chrono>
 #include "timbl/TimblAPI.h"
 #include "config.h"
 #include "mbt/Logging.h"
@@ -47,7 +48,9 @@ using namespace Tagger;
 using namespace TiCC;
 using namespace icu;
 
-MbtAPI::MbtAPI( const std::string& optstring ){
+MbtAPI::MbtAPI( const std::string& optstring ):
+  tagger(0), pool_requests(0), pool_waits(0), pool_wait_ns(0)
+{
   TiCC::CL_Options opts;
   opts.allow_args( mbt_short_opts, mbt_long_opts );
   try {
@@ -67,9 +70,12 @@ MbtAPI::MbtAPI( const std::string& optstring ){
     return;
   }
   tagger = TaggerClass::StartTagger( opts );
+  init_pool();
 }
 
-MbtAPI::MbtAPI( const string& optstring, TiCC::LogStream& ls ){
+MbtAPI::MbtAPI( const string& optstring, TiCC::LogStream& ls ):
+  tagger(0), pool_requests(0), pool_waits(0), pool_wait_ns(0)
+{
   TiCC::CL_Options opts;
   opts.allow_args( mbt_short_opts, mbt_long_opts );
   try {
@@ -89,19 +95,90 @@ MbtAPI::MbtAPI( const string& optstring, TiCC::LogStream& ls ){
     return;
   }
   tagger = TaggerClass::StartTagger( opts, &ls );
+  init_pool();
 }
 
 MbtAPI::~MbtAPI(){
+  for ( const auto& s : sessions ){
+    delete s;
+  }
   delete tagger;
 }
 
+void MbtAPI::init_pool(){
+  /// when the tagger is started with -j N, create a pool of N sessions
+  /*!
+    Every session is a clone of the tagger. Tag() and TagLine() take a free
+    session from the pool for the duration of the call, so they may be
+    called from several threads at once.
+  */
+  if ( tagger && tagger->isInit() ){
+    for ( int i=0; i < tagger->threads(); ++i ){
+      sessions.push_back( tagger->clone() );
+    }
+    free_sessions = sessions;
+  }
+}
+
+TaggerClass *MbtAPI::acquire(){
+  if ( sessions.empty() ){
+    return tagger;
+  }
+  ++pool_requests;
+  std::unique_lock<std::mutex> lock( pool_lock );
+  if ( free_sessions.empty() ){
+    // all sessions are busy. Wait, and keep track of the contention
+    ++pool_waits;
+    auto start = std::chrono::steady_clock::now();
+    pool_cond.wait( lock, [this]{ return !free_sessions.empty(); } );
+    auto waited = std::chrono::steady_clock::now() - start;
+    pool_wait_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count();
+  }
+  TaggerClass *result = free_sessions.back();
+  free_sessions.pop_back();
+  return result;
+}
+
+void MbtAPI::release( TaggerClass *session ){
+  if ( session == tagger ){
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock( pool_lock );
+    free_sessions.push_back( session );
+  }
+  pool_cond.notify_all();
+}
+
+double MbtAPI::poolWaitTime() const {
+  /// the total time (in seconds) that callers waited for a free session
+  return pool_wait_ns / 1.0e9;
+}
+
+class session_guard {
+  /// holds a session of the pool of an MbtAPI during its lifetime
+public:
+  explicit session_guard( MbtAPI *api ): owner(api){
+    session = owner->acquire();
+  }
+  ~session_guard(){
+    owner->release( session );
+  }
+  TaggerClass *session;
+private:
+  MbtAPI *owner;
+  session_guard( const session_guard& ); // inhibit copies
+  session_guard& operator=( const session_guard& ); // inhibit copies
+};
+
 bool MbtAPI::isInit() const{
   return tagger && tagger->isInit();
 }
 
 UnicodeString MbtAPI::Tag( const UnicodeString& inp ){
   if ( tagger ){
-    return tagger->Tag( inp );
+    session_guard guard( this );
+    return guard.session->Tag( inp );
   }
   else {
     throw std::runtime_error( "No tagger initialized yet...." );
@@ -110,7 +187,24 @@ UnicodeString MbtAPI::Tag( const UnicodeString& inp ){
 
 vector<TagResult> MbtAPI::TagLine( const UnicodeString& inp ){
   if ( tagger ){
-    return tagger->tagLine( inp );
+    session_guard guard( this );
+    return guard.session->tagLine( inp );
+  }
+  else {
+    throw std::runtime_error( "No tagger initialized yet...." );
+  }
+}
+
+vector<vector<TagResult>> MbtAPI::TagLines( const vector<UnicodeString>& lines ){
+  /// tag a batch of lines at once
+  /*!
+    With -j N, the lines are spread over N clones by the work-stealing
+    scheduler of the tagger. Concurrent batches are tagged one after the
+    other.
+  */
+  if ( tagger ){
+    std::lock_guard<std::mutex> lock( batch_lock );
+    return tagger->tagLines( lines, tagger->threads() );
   }
   else {
     throw std::runtime_error( "No tagger initialized yet...." );
@@ -128,6 +222,13 @@ UnicodeString MbtAPI::getResult( const vector<TagResult>& v ) const {
 
 UnicodeString MbtAPI::set_eos_mark( const UnicodeString& eos ){
   if ( tagger ){
+    // wait until no session is in use, and then change them all
+    std::unique_lock<std::mutex> lock( pool_lock );
+    pool_cond.wait( lock,
+		    [this]{ return free_sessions.size() == sessions.size(); } );
+    for ( const auto& s : sessions ){
+      s->set_eos_mark( eos );
+    }
     return tagger->set_eos_mark( eos );
   }
   else {
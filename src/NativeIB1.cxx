@@ -0,0 +1,465 @@
+/*
+  Copyright (c) 1998 - 2026
+  CLST  - Radboud University
+  ILK   - Tilburg University
+  CLiPS - University of Antwerp
+
+  This file is part of mbt
+
+  mbt is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  mbt is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/mbt/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+#include <string>
+#include <algorithm>
+#include <numeric>
+
+#include "mbt/Tagger.h"
+#include "mbt/CaseBase.h"
+#include "mbt/NativeIB1.h"
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define MBT_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace Tagger {
+  using namespace std;
+
+  // A kernel computes for instances [0,n) the summed weight of the
+  // matching features. cols[j] is the column of the j-th feature, q[j]
+  // the pattern value and w[j] the weight for that feature.
+  // All kernels add the weights in the same order, so they give exactly
+  // the same sums.
+  typedef void (*scan_kernel)( const int *const *cols,
+			       const int *q,
+			       const double *w,
+			       size_t nf,
+			       size_t n,
+			       double *sim );
+
+  static void scan_scalar( const int *const *cols,
+			   const int *q,
+			   const double *w,
+			   size_t nf,
+			   size_t n,
+			   double *sim ){
+    for ( size_t i=0; i < n; ++i ){
+      double acc = 0.0;
+      for ( size_t j=0; j < nf; ++j ){
+	acc += ( cols[j][i] == q[j] ) ? w[j] : 0.0;
+      }
+      sim[i] = acc;
+    }
+  }
+
+#ifdef MBT_X86_KERNELS
+  __attribute__((target("sse4.1")))
+  static void scan_sse4( const int *const *cols,
+			 const int *q,
+			 const double *w,
+			 size_t nf,
+			 size_t n,
+			 double *sim ){
+    size_t i = 0;
+    for ( ; i+4 <= n; i += 4 ){
+      __m128d lo = _mm_setzero_pd();
+      __m128d hi = _mm_setzero_pd();
+      for ( size_t j=0; j < nf; ++j ){
+	__m128i c = _mm_loadu_si128( (const __m128i*)( cols[j] + i ) );
+	__m128i m = _mm_cmpeq_epi32( c, _mm_set1_epi32( q[j] ) );
+	__m128d wj = _mm_set1_pd( w[j] );
+	lo = _mm_add_pd( lo, _mm_and_pd( _mm_castsi128_pd( _mm_cvtepi32_epi64( m ) ), wj ) );
+	hi = _mm_add_pd( hi, _mm_and_pd( _mm_castsi128_pd( _mm_cvtepi32_epi64( _mm_srli_si128( m, 8 ) ) ), wj ) );
+      }
+      _mm_storeu_pd( sim + i, lo );
+      _mm_storeu_pd( sim + i + 2, hi );
+    }
+    for ( ; i < n; ++i ){
+      double acc = 0.0;
+      for ( size_t j=0; j < nf; ++j ){
+	acc += ( cols[j][i] == q[j] ) ? w[j] : 0.0;
+      }
+      sim[i] = acc;
+    }
+  }
+
+  __attribute__((target("avx2")))
+  static void scan_avx2( const int *const *cols,
+			 const int *q,
+			 const double *w,
+			 size_t nf,
+			 size_t n,
+			 double *sim ){
+    size_t i = 0;
+    for ( ; i+8 <= n; i += 8 ){
+      __m256d lo = _mm256_setzero_pd();
+      __m256d hi = _mm256_setzero_pd();
+      for ( size_t j=0; j < nf; ++j ){
+	__m256i c = _mm256_loadu_si256( (const __m256i*)( cols[j] + i ) );
+	__m256i m = _mm256_cmpeq_epi32( c, _mm256_set1_epi32( q[j] ) );
+	__m256d wj = _mm256_set1_pd( w[j] );
+	__m256i mlo = _mm256_cvtepi32_epi64( _mm256_castsi256_si128( m ) );
+	__m256i mhi = _mm256_cvtepi32_epi64( _mm256_extracti128_si256( m, 1 ) );
+	lo = _mm256_add_pd( lo, _mm256_and_pd( _mm256_castsi256_pd( mlo ), wj ) );
+	hi = _mm256_add_pd( hi, _mm256_and_pd( _mm256_castsi256_pd( mhi ), wj ) );
+      }
+      _mm256_storeu_pd( sim + i, lo );
+      _mm256_storeu_pd( sim + i + 4, hi );
+    }
+    for ( ; i < n; ++i ){
+      double acc = 0.0;
+      for ( size_t j=0; j < nf; ++j ){
+	acc += ( cols[j][i] == q[j] ) ? w[j] : 0.0;
+      }
+      sim[i] = acc;
+    }
+  }
+#endif
+
+  static scan_kernel select_kernel( const char *&name ){
+    /// pick the best kernel this cpu supports
+#ifdef MBT_X86_KERNELS
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports( "avx2" ) ){
+      name = "AVX2";
+      return scan_avx2;
+    }
+    if ( __builtin_cpu_supports( "sse4.1" ) ){
+      name = "SSE4.1";
+      return scan_sse4;
+    }
+#endif
+    name = "scalar";
+    return scan_scalar;
+  }
+
+  static const char *kernel_label = 0;
+  static const scan_kernel the_kernel = select_kernel( kernel_label );
+
+  const char *NativeIB1::kernel_name(){
+    return kernel_label;
+  }
+
+  void NativeIB1::build( const CaseBase& cb ){
+    /// build the index (or the columns) for the instances in \e cb
+    num_features = cb.num_features;
+    values = cb.values;
+    dist_begin = cb.dist_begin;
+    dist = cb.dist;
+    classes = cb.classes;
+    cb.global_counts( global );
+    cb.gain_ratios( weights );
+    total_weight = accumulate( weights.begin(), weights.end(), 0.0 );
+    order.resize( num_features );
+    iota( order.begin(), order.end(), 0 );
+    stable_sort( order.begin(), order.end(),
+		 [&]( size_t a, size_t b ){ return weights[a] > weights[b]; } );
+    value_data.set( values );
+    dist_begin_data.set( dist_begin );
+    dist_data.set( dist );
+    if ( use_scan ){
+      make_columns();
+      return;
+    }
+    // per feature, the distinct values in ascending order. For every
+    // value the instances which have it are consecutive in postings
+    postings.clear();
+    postings.reserve( size() * num_features );
+    keys.clear();
+    key_begin.clear();
+    feature_keys.clear();
+    vector<pair<int,unsigned int>> pairs( size() );
+    for ( size_t f=0; f < num_features; ++f ){
+      feature_keys.push_back( keys.size() );
+      for ( size_t i=0; i < size(); ++i ){
+	pairs[i] = make_pair( cb.value(i,f), i );
+      }
+      sort( pairs.begin(), pairs.end() );
+      for ( size_t p=0; p < pairs.size(); ++p ){
+	if ( p == 0 || pairs[p].first != pairs[p-1].first ){
+	  keys.push_back( pairs[p].first );
+	  key_begin.push_back( postings.size() );
+	}
+	postings.push_back( pairs[p].second );
+      }
+    }
+    feature_keys.push_back( keys.size() );
+    key_begin.push_back( postings.size() );
+    postings_data.set( postings );
+    key_data.set( keys );
+    key_begin_data.set( key_begin );
+  }
+
+  void NativeIB1::make_columns(){
+    /// store the values column by column, for scan()
+    columns.resize( num_features * size() );
+    for ( size_t f=0; f < num_features; ++f ){
+      for ( size_t i=0; i < size(); ++i ){
+	columns[f*size()+i] = value_data[i*num_features+f];
+      }
+    }
+  }
+
+  void NativeIB1::save( BundleWriter& bw, const string& prefix ) const {
+    /// add the case base and its index to a bundle, in sections starting
+    /// with \e prefix
+    vector<size_t> sizes;
+    sizes.push_back( num_features );
+    bw.add( prefix + ".sizes", sizes );
+    bw.add( prefix + ".order", order );
+    bw.add( prefix + ".weights", weights );
+    bw.add( prefix + ".global", global );
+    bw.add( prefix + ".classes", classes );
+    bw.add( prefix + ".features", feature_keys );
+    bw.add( prefix + ".values", value_data.data(),
+	    value_data.size() * sizeof(int) );
+    bw.add( prefix + ".dist_begin", dist_begin_data.data(),
+	    dist_begin_data.size() * sizeof(size_t) );
+    bw.add( prefix + ".dist", dist_data.data(),
+	    dist_data.size() * sizeof(pair<int,double>) );
+    bw.add( prefix + ".postings", postings_data.data(),
+	    postings_data.size() * sizeof(unsigned int) );
+    bw.add( prefix + ".keys", key_data.data(),
+	    key_data.size() * sizeof(int) );
+    bw.add( prefix + ".key_begin", key_begin_data.data(),
+	    key_begin_data.size() * sizeof(size_t) );
+  }
+
+  bool NativeIB1::attach( const Bundle& bundle, const string& prefix ){
+    /// use the case base and index stored in \e bundle under \e prefix
+    /*!
+      The big arrays stay in the bundle, so \e bundle must outlive us.
+      In scan mode, the columns are made from the stored values.
+    */
+    size_t n = 0;
+    const size_t *sz = bundle.array<size_t>( prefix + ".sizes", n );
+    if ( n != 1 ){
+      return false;
+    }
+    num_features = sz[0];
+    const size_t *o = bundle.array<size_t>( prefix + ".order", n );
+    order.assign( o, o+n );
+    const double *w = bundle.array<double>( prefix + ".weights", n );
+    weights.assign( w, w+n );
+    total_weight = accumulate( weights.begin(), weights.end(), 0.0 );
+    const double *g = bundle.array<double>( prefix + ".global", n );
+    global.assign( g, g+n );
+    const int *c = bundle.array<int>( prefix + ".classes", n );
+    classes.assign( c, c+n );
+    const size_t *fk = bundle.array<size_t>( prefix + ".features", n );
+    feature_keys.assign( fk, fk+n );
+    const int *v = bundle.array<int>( prefix + ".values", n );
+    value_data.set( v, n );
+    const size_t *db = bundle.array<size_t>( prefix + ".dist_begin", n );
+    dist_begin_data.set( db, n );
+    const pair<int,double> *d = bundle.array<pair<int,double>>( prefix + ".dist", n );
+    dist_data.set( d, n );
+    const unsigned int *p = bundle.array<unsigned int>( prefix + ".postings", n );
+    postings_data.set( p, n );
+    const int *k = bundle.array<int>( prefix + ".keys", n );
+    key_data.set( k, n );
+    const size_t *kb = bundle.array<size_t>( prefix + ".key_begin", n );
+    key_begin_data.set( kb, n );
+    if ( order.size() != num_features
+	 || weights.size() != num_features
+	 || value_data.size() != size() * num_features ){
+      return false;
+    }
+    if ( use_scan ){
+      make_columns();
+    }
+    else if ( feature_keys.size() != num_features+1 ){
+      return false;
+    }
+    return true;
+  }
+
+  double NativeIB1::scan( const vector<int>& pattern,
+			  IB1Scratch& s ) const {
+    /// compute the similarity of all instances with \e pattern, and
+    /// leave the most similar ones in s.touched
+    size_t n = size();
+    s.sim.resize( n );
+    s.cols.clear();
+    s.query.clear();
+    s.query_weights.clear();
+    for ( const auto& f : order ){
+      if ( weights[f] <= 0.0 ){
+	break;
+      }
+      s.cols.push_back( &columns[f*n] );
+      s.query.push_back( pattern[f] );
+      s.query_weights.push_back( weights[f] );
+    }
+    the_kernel( s.cols.data(), s.query.data(), s.query_weights.data(),
+		s.cols.size(), n, s.sim.data() );
+    double best = 0.0;
+    for ( size_t i=0; i < n; ++i ){
+      best = max( best, s.sim[i] );
+    }
+    s.touched.clear();
+    if ( best > 0.0 ){
+      for ( size_t i=0; i < n; ++i ){
+	if ( s.sim[i] == best ){
+	  s.touched.push_back( i );
+	}
+      }
+    }
+    return best;
+  }
+
+  double NativeIB1::search( const vector<int>& pattern,
+			    IB1Scratch& s ) const {
+    /// find the instances most similar to \e pattern using the index
+    /*!
+      sim[i] is the summed weight of the features on which instance i
+      matches the pattern, so its distance is total_weight - sim[i]. An
+      instance is a candidate as soon as it matches one feature.
+      On return s.touched holds the candidates.
+    */
+    if ( s.sim.size() != size() ){
+      s.sim.assign( size(), 0.0 );
+    }
+    s.touched.clear();
+    double best = 0.0;
+    double remaining = total_weight;
+    // 'remaining' drifts from the true sum of the weights still to come
+    // by rounding. Being generous by this much only keeps some more
+    // candidates, the final choice compares the exact sums.
+    const double slack = 1e-9 * total_weight;
+    bool growing = true;
+    for ( const auto& f : order ){
+      double w = weights[f];
+      if ( w <= 0.0 ){
+	break; // the rest weighs nothing either
+      }
+      remaining -= w;
+      int v = pattern[f];
+      if ( growing ){
+	const int *lo = key_data.data() + feature_keys[f];
+	const int *hi = key_data.data() + feature_keys[f+1];
+	const int *it = lower_bound( lo, hi, v );
+	if ( it != hi && *it == v ){
+	  size_t key = it - key_data.data();
+	  for ( size_t p=key_begin_data[key]; p < key_begin_data[key+1]; ++p ){
+	    unsigned int i = postings_data[p];
+	    if ( s.sim[i] == 0.0 ){
+	      if ( max_candidates > 0 && s.touched.size() >= max_candidates ){
+		continue; // approximate: no room for new candidates
+	      }
+	      s.touched.push_back( i );
+	    }
+	    s.sim[i] += w;
+	    best = max( best, s.sim[i] );
+	  }
+	}
+	// an instance which isn't a candidate yet can at most score
+	// 'remaining'. When that is less than the best, we are complete
+	growing = best <= remaining + slack;
+      }
+      else {
+	// only refine the candidates, and drop the hopeless ones
+	size_t keep = 0;
+	for ( size_t c=0; c < s.touched.size(); ++c ){
+	  unsigned int i = s.touched[c];
+	  if ( value_data[i*num_features+f] == v ){
+	    s.sim[i] += w;
+	    best = max( best, s.sim[i] );
+	  }
+	}
+	for ( size_t c=0; c < s.touched.size(); ++c ){
+	  unsigned int i = s.touched[c];
+	  if ( s.sim[i] + remaining + slack >= best ){
+	    s.touched[keep++] = i;
+	  }
+	  else {
+	    s.sim[i] = 0.0;
+	  }
+	}
+	s.touched.resize( keep );
+      }
+    }
+    return best;
+  }
+
+  bool NativeIB1::classify( const vector<int>& pattern,
+			    bool with_string,
+			    SymbolTable& symbols,
+			    IB1Scratch& s,
+			    Classification& cl ) const {
+    /// find the nearest neighbours of \e pattern and classify it
+    /*!
+      \return false when the neighbours don't have one most frequent
+      class. \e cl is left empty then.
+    */
+    double best = use_scan ? scan( pattern, s ) : search( pattern, s );
+    s.entries.clear();
+    if ( best == 0.0 ){
+      // nothing matches at all: every instance is a nearest neighbour
+      for ( size_t c=0; c < global.size(); ++c ){
+	if ( global[c] > 0 ){
+	  s.entries.push_back( make_pair( c, global[c] ) );
+	}
+      }
+    }
+    else {
+      s.acc.resize( global.size(), 0.0 );
+      s.seen.clear();
+      for ( const auto& i : s.touched ){
+	if ( s.sim[i] == best ){
+	  for ( size_t d=dist_begin_data[i]; d < dist_begin_data[i+1]; ++d ){
+	    const auto& e = dist_data[d];
+	    if ( s.acc[e.first] == 0.0 ){
+	      s.seen.push_back( e.first );
+	    }
+	    s.acc[e.first] += e.second;
+	  }
+	}
+      }
+      sort( s.seen.begin(), s.seen.end() );
+      for ( const auto& c : s.seen ){
+	s.entries.push_back( make_pair( c, s.acc[c] ) );
+	s.acc[c] = 0.0;
+      }
+    }
+    for ( const auto& i : s.touched ){
+      s.sim[i] = 0.0;
+    }
+    size_t answer = 0;
+    bool tie = false;
+    for ( size_t e=1; e < s.entries.size(); ++e ){
+      if ( s.entries[e].second > s.entries[answer].second ){
+	answer = e;
+	tie = false;
+      }
+      else if ( s.entries[e].second == s.entries[answer].second ){
+	tie = true;
+      }
+    }
+    if ( tie ){
+      cl.clear();
+      return false;
+    }
+    fill_classification( s.entries.data(), s.entries.size(),
+			 classes, answer, with_string, symbols, cl );
+    cl.distance = total_weight - best;
+    return true;
+  }
+
+}
@@ -37,6 +37,13 @@
 #include <ctime>
 #include <csignal>
 #include <cassert>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 
 #include "config.h"
 #include "timbl/TimblAPI.h"
@@ -47,10 +54,11 @@
 #include "mbt/Sentence.h"
 #include "mbt/Logging.h"
 #include "mbt/Tagger.h"
-
-#if defined(HAVE_PTHREAD)
-#include <pthread.h>
-#endif
+#include "mbt/Scheduler.h"
+#include "mbt/ClassifyCache.h"
+#include "mbt/CaseBase.h"
+#include "mbt/NativeIB1.h"
+#include "mbt/Bundle.h"
 
 using namespace TiCC;
 using namespace nlohmann;
@@ -58,7 +66,6 @@ using namespace nlohmann;
 namespace Tagger {
   using namespace std;
   using namespace icu;
-  using namespace Hash;
   using namespace Timbl;
   using TiCC::operator<<;
 
@@ -66,7 +73,8 @@ namespace Tagger {
 
   class BeamData;
 
-  BeamData::BeamData():size(0){
+  BeamData::BeamData():
+    size(0),filled(0),signature_depth(-1),threshold(0.0){
   }
 
   BeamData::~BeamData(){
@@ -74,18 +82,24 @@ namespace Tagger {
 
   void BeamData::Init( int Size, unsigned int noWords ){
     // Beaming Stuff...
-    if ( path_prob.size() == 0 ){
+    if ( path_score.size() == 0 ){
       // the first time
-      path_prob.resize(Size);
+      path_score.resize(Size);
+      cand_score.resize(Size);
       n_best_array.resize(Size);
-      paths.resize(Size);
-      temppaths.resize(Size);
-    }
-    for ( int q=0; q < Size; ++q ){
-      paths[q].resize(noWords,0);
-      temppaths[q].resize(noWords,0);
     }
     size = Size;
+    filled = 0;
+    // one slot per position and entry. Only grows, so a run of sentences
+    // of similar length doesn't allocate
+    if ( lattice_tag.size() < noWords*Size ){
+      lattice_tag.resize( noWords*Size );
+      lattice_back.resize( noWords*Size );
+      lattice_root.resize( noWords*Size );
+    }
+    // positions right of the focus are never filled in by Context()
+    context.assign( noWords, EMPTY_PATH );
+    best_path.resize( noWords );
   }
 
   void BeamData::ClearBest(){
@@ -95,224 +109,383 @@ namespace Tagger {
     }
   }
 
-  void BeamData::Shift(	int no_words, int i_word ){
-    for ( int q1 = 0; q1 < no_words; ++q1 ){
-      for ( int jb = 0; jb < size; ++jb ){
-	path_prob[jb] = n_best_array[jb].prob;
-	if ( n_best_array[jb].path != EMPTY_PATH ){
-	  if ( q1 < i_word ){
-	    DBG << "shift paths[" << n_best_array[jb].path << ","
-		<< q1 << "] into paths[" << jb << "," << q1 << "]" << endl;
-	    temppaths[jb][q1] = paths[n_best_array[jb].path][q1];
-	  }
-	  else if ( q1 == i_word ){
-	    DBG << "shift tag " <<  n_best_array[jb].tag
-		<< " into paths[" << jb << "," << q1 << "]" << endl;
-	    temppaths[jb][q1] = n_best_array[jb].tag;
-	  }
-	  else {
-	    temppaths[jb][q1] = EMPTY_PATH;
-	  }
-	}
-	else {
-	  temppaths[jb][q1] = EMPTY_PATH;
-	}
+  void BeamData::Shift( int i_word ){
+    /// store the n best extensions as the entries of position \e i_word
+    int *tags = &lattice_tag[i_word*size];
+    int *backs = &lattice_back[i_word*size];
+    int *roots = &lattice_root[i_word*size];
+    const int *prev_roots = &lattice_root[(i_word-1)*size];
+    for ( int jb = 0; jb < size; ++jb ){
+      path_score[jb] = n_best_array[jb].score;
+      if ( n_best_array[jb].path != EMPTY_PATH ){
+	DBG << "shift tag " <<  n_best_array[jb].tag
+	    << " into lattice[" << i_word << "," << jb << "] after entry "
+	    << n_best_array[jb].path << endl;
+	tags[jb] = n_best_array[jb].tag;
+	backs[jb] = n_best_array[jb].path;
+	roots[jb] = prev_roots[n_best_array[jb].path];
+      }
+      else {
+	tags[jb] = EMPTY_PATH;
+	backs[jb] = EMPTY_PATH;
+	roots[jb] = EMPTY_PATH;
+      }
+    }
+    filled = i_word + 1;
+    Prune( i_word );
+  }
+
+  void BeamData::Prune( int pos ){
+    /// drop the entries at \e pos that are less than \e threshold times
+    /// as probable as the best one
+    /*!
+      The best one isn't always the first: at position 0 the answer of
+      the classifier comes first. The entries that stay are moved to the
+      front, in the same order, so the live part of the beam has no holes
+      and the next position expands fewer paths.
+    */
+    if ( threshold <= 0.0 ){
+      return;
+    }
+    int *tags = &lattice_tag[pos*size];
+    int *backs = &lattice_back[pos*size];
+    int *roots = &lattice_root[pos*size];
+    double best = NO_SCORE;
+    for ( int jb = 0; jb < size; ++jb ){
+      if ( tags[jb] != EMPTY_PATH ){
+	best = max( best, path_score[jb] );
       }
     }
+    double floor = log( threshold ) + best;
+    int keep = 0;
     for ( int jb = 0; jb < size; ++jb ){
-      for ( int q1=0; q1 < no_words; ++q1 ){
-	paths[jb][q1] = temppaths[jb][q1];
+      if ( tags[jb] == EMPTY_PATH ){
+	continue;
+      }
+      if ( path_score[jb] < floor ){
+	DBG << "prune lattice[" << pos << "," << jb << "] "
+	    << path_score[jb] << " < " << floor << endl;
+	continue;
       }
+      tags[keep] = tags[jb];
+      backs[keep] = backs[jb];
+      roots[keep] = roots[jb];
+      path_score[keep] = path_score[jb];
+      ++keep;
+    }
+    for ( int jb = keep; jb < size; ++jb ){
+      tags[jb] = EMPTY_PATH;
+      backs[jb] = EMPTY_PATH;
+      roots[jb] = EMPTY_PATH;
+      path_score[jb] = NO_SCORE;
     }
   }
 
-  void BeamData::Print( ostream& os, int i_word, UnicodeHash& TheLex ){
+  bool BeamData::same_signature( int path1, int tag1,
+				 int path2, int tag2 ) const {
+    /// do the extensions ( \e path1, \e tag1 ) and ( \e path2, \e tag2 )
+    /// of the entries at the last position end in the same
+    /// \e signature_depth tags?
+    if ( signature_depth == 0 ){
+      return true;
+    }
+    if ( tag1 != tag2 ){
+      return false;
+    }
+    int pos = filled - 1;
+    for ( int d = 1; d < signature_depth && pos >= 0; ++d ){
+      if ( path1 == path2 ){
+	// a shared history
+	return true;
+      }
+      if ( lattice_tag[pos*size+path1] != lattice_tag[pos*size+path2] ){
+	return false;
+      }
+      path1 = lattice_back[pos*size+path1];
+      path2 = lattice_back[pos*size+path2];
+      --pos;
+    }
+    return true;
+  }
+
+  const vector<int>& BeamData::Context( int beam, int i_word, int depth ){
+    /// the tags of the path ending in entry \e beam at position
+    /// \e i_word - 1
+    /*!
+      Only the \e depth positions left of \e i_word and position 0 are
+      filled in, that is all that sentence::nextpat() looks at. Positions
+      from \e i_word on stay EMPTY_PATH.
+    */
+    int pos = i_word - 1;
+    int entry = beam;
+    for ( int d = 0; d < depth && pos >= 0 && entry != EMPTY_PATH; ++d ){
+      context[pos] = lattice_tag[pos*size+entry];
+      entry = lattice_back[pos*size+entry];
+      --pos;
+    }
+    context[0] = lattice_root[(i_word-1)*size+beam];
+    return context;
+  }
+
+  const vector<int>& BeamData::Backtrace(){
+    /// follow the backpointers from the best entry at the last position
+    /*!
+      \return the tags of the best path, EMPTY_PATH for positions that
+      were never decoded
+    */
+    int entry = 0;
+    for ( int pos = filled-1; pos >= 0; --pos ){
+      if ( entry == EMPTY_PATH ){
+	best_path[pos] = EMPTY_PATH;
+      }
+      else {
+	best_path[pos] = lattice_tag[pos*size+entry];
+	entry = lattice_back[pos*size+entry];
+      }
+    }
+    for ( size_t pos = filled; pos < best_path.size(); ++pos ){
+      best_path[pos] = EMPTY_PATH;
+    }
+    return best_path;
+  }
+
+  void BeamData::Print( ostream& os, int i_word, SymbolTable& TheLex ){
     for ( int i=0; i < size; ++i ){
-      os << "path_prob[" << i << "] = " << path_prob[i] << endl;
+      os << "path_score[" << i << "] = " << path_score[i]
+	 << " (" << posterior( i ) << ")" << endl;
     }
     for ( int j=0; j <= i_word; ++j ){
       for ( int i=0; i < size; ++i ){
-	if (  paths[i][j] != EMPTY_PATH ){
-	  DBG << "    paths[" << i << "," << j << "] = "
-	      << indexlex( paths[i][j], TheLex ) << endl;
+	if ( tag_at( j, i ) != EMPTY_PATH ){
+	  DBG << "    lattice[" << j << "," << i << "] = "
+	      << indexlex( tag_at( j, i ), TheLex );
+	  if ( j > 0 ){
+	    DBG << " after " << lattice_back[j*size+i];
+	  }
+	  DBG << endl;
 	}
 	else {
-	  DBG << "    paths[" << i << "," << j << "] = EMPTY" << endl;
+	  DBG << "    lattice[" << j << "," << i << "] = EMPTY" << endl;
 	}
       }
     }
   }
 
-  void BeamData::PrintBest( ostream& os, UnicodeHash& TheLex ){
+  void BeamData::PrintBest( ostream& os, SymbolTable& TheLex ){
     for ( int i=0; i < size; ++i ){
       if (  n_best_array[i].path != EMPTY_PATH ){
 	os << "n_best_array[" << i << "] = "
-	   << n_best_array[i].prob << " "
+	   << n_best_array[i].score << " "
 	   << n_best_array[i].path << " "
 	   << indexlex( n_best_array[i].tag, TheLex ) << endl;
       }
       else {
 	os << "n_best_array[" << i << "] = "
-	    << n_best_array[i].prob << " EMPTY " << endl;
+	    << n_best_array[i].score << " EMPTY " << endl;
       }
     }
   }
 
-  class name_prob_pair{
-  public:
-    name_prob_pair( const UnicodeString& n, double p ): name(n),prob(p){
-      next = 0;
-    }
-    ~name_prob_pair(){};
-    UnicodeString name;
-    double prob;
-    name_prob_pair *next;
-  private:
-    name_prob_pair( const name_prob_pair& ); // inhibit copies
-    name_prob_pair operator=( const name_prob_pair& ); // inhibit copies
-  };
-
-  name_prob_pair *add_descending( name_prob_pair *n, name_prob_pair *lst ){
-    name_prob_pair *result;
-    if ( lst == 0 ){
-      result = n;
-    }
-    else if ( n->prob - lst->prob >= 0 ){
-      result = n;
-      n->next = lst;
-    }
-    else {
-      result = lst;
-      result->next = add_descending( n, result->next );
-    }
-    return result;
+  static bool more_probable( const tag_prob& a, const tag_prob& b ){
+    // descending on probability. Equal ones in reverse Timbl order, as
+    // the insertion sort we used before did
+    return a.prob > b.prob || ( a.prob == b.prob && a.order > b.order );
   }
 
-
-  name_prob_pair *break_down( const ClassDistribution *Dist,
-			      const TargetValue *PrefClass ){
-    // split a distribution into names/probabilities  AND sort them descending
-    // But put preferred in front.
-    // While we will use only the first BeamSize entries, don't forget
-    // the most important one...!
-    name_prob_pair *result = 0, *tmp, *Pref = 0;
-    if ( !Dist ){
-      return 0;
+  void break_down( const Classification& cl,
+		   size_t want,
+		   vector<tag_prob>& result ){
+    // split a distribution into tags/probabilities AND put the \e want
+    // most probable ones in front, sorted descending.
+    // But put preferred in front, whatever its frequency.
+    // \e result is scratch space owned by the caller, once it has grown
+    // to the size of the largest distribution, this doesn't allocate
+    result.clear();
+    if ( cl.distribution.empty() ){
+      return;
     }
     double sum_freq = 0.0;
-    for ( const auto& it : *Dist ){
-      UnicodeString name = it.second->Value()->name();
-      double freq = it.second->Weight();
-      sum_freq += freq;
-      tmp = new name_prob_pair( name, freq );
-      if ( name == PrefClass->name() ){
-	assert( Pref == 0 );
-	Pref = tmp;
+    int pref = -1;
+    int order = 0;
+    for ( const auto& it : cl.distribution ){
+      sum_freq += it.second;
+      if ( it.first == cl.answer ){
+	assert( pref < 0 );
+	pref = order;
       }
       else {
-	result = add_descending( tmp, result );
+	result.push_back( tag_prob( it.first, it.second, order ) );
       }
+      ++order;
+    }
+    if ( pref >= 0 && want > 0 ){
+      --want;
+    }
+    if ( want < result.size() ){
+      partial_sort( result.begin(), result.begin() + want, result.end(),
+		    more_probable );
+      result.erase( result.begin() + want, result.end() );
+    }
+    else {
+      sort( result.begin(), result.end(), more_probable );
     }
-    if ( Pref ){
-      Pref->next = result;
-      result = Pref;
+    if ( pref >= 0 ){
+      const auto& it = cl.distribution[pref];
+      result.insert( result.begin(), tag_prob( it.first, it.second, pref ) );
     }
     //
     // Now we must Normalize te get real Probabilities
-    tmp = result;
-    while ( tmp ){
-      tmp->prob = tmp->prob / sum_freq;
-      tmp = tmp->next;
+    for ( auto& tp : result ){
+      tp.prob = tp.prob / sum_freq;
     }
-    return result;
   }
 
-  void BeamData::InitPaths( UnicodeHash& TheLex,
-			    const TargetValue *answer,
-			    const ClassDistribution *distrib ){
+  void BeamData::InitPaths( const Classification& cl ){
     if ( size == 1 ){
-      paths[0][0] = TheLex.hash( answer->name() );
-      path_prob[0] = 1.0;
+      lattice_tag[0] = cl.answer;
+      path_score[0] = 0.0;
     }
     else {
-      name_prob_pair *d_pnt, *Distr;
-      Distr = break_down( distrib, answer );
-      d_pnt = Distr;
+      vector<tag_prob>& Distr = distr;
+      break_down( cl, size, Distr );
       int jb = 0;
-      while ( d_pnt ){
-	if ( jb < size ){
-	  paths[jb][0] =  TheLex.hash( d_pnt->name );
-	  path_prob[jb] = d_pnt->prob;
-	}
-	name_prob_pair *tmp_d_pnt = d_pnt;
-	d_pnt = d_pnt->next;
-	delete tmp_d_pnt;
-	jb++;
+      for ( ; jb < size && jb < (int)Distr.size(); ++jb ){
+	lattice_tag[jb] = Distr[jb].tag;
+	path_score[jb] = log( Distr[jb].prob );
       }
       for ( ; jb < size; ++jb ){
-	paths[jb][0] = EMPTY_PATH;
-	path_prob[jb] = 0.0;
+	lattice_tag[jb] = EMPTY_PATH;
+	path_score[jb] = NO_SCORE;
       }
     }
+    for ( int jb = 0; jb < size; ++jb ){
+      lattice_back[jb] = EMPTY_PATH;
+      lattice_root[jb] = lattice_tag[jb];
+    }
+    filled = 1;
+    Prune( 0 );
   }
 
-  void BeamData::NextPath( UnicodeHash& TheLex,
-			   const TargetValue *answer,
-			   const ClassDistribution *distrib,
+  void BeamData::NextPath( const Classification& cl,
 			   int beam_cnt ){
     if ( size == 1 ){
-      n_best_array[0].prob = 1.0;
+      n_best_array[0].score = 0.0;
       n_best_array[0].path = beam_cnt;
-      n_best_array[0].tag = TheLex.hash( answer->name() );
+      n_best_array[0].tag = cl.answer;
     }
     else {
-      DBG << "BeamData::NextPath[" << beam_cnt << "] ( " << answer << " , "
-	  << distrib << " )" << endl;
-      name_prob_pair *d_pnt, *Distr;
-      Distr = break_down( distrib, answer );
-      d_pnt = Distr;
-      int ab = 0;
-      while ( d_pnt ){
-	if ( ab < size ){
-	  double thisWProb = d_pnt->prob;
-	  double thisPProb = thisWProb * path_prob[beam_cnt];
-	  int dtag = TheLex.hash( d_pnt->name );
-	  for ( int ane = size-1; ane >=0; --ane ){
-	    if ( thisPProb <= n_best_array[ane].prob )
-	      break;
-	    if ( ane == 0 ||
-		 thisPProb <= n_best_array[ane-1].prob ){
- 	      if ( ane == 0 ){
- 		DBG << "Insert, n=0" << endl;
-	      }
- 	      else {
- 		DBG << "Insert, n=" << ane << " Prob = " << thisPProb
-		    << " after prob = " << n_best_array[ane-1].prob
-		    << endl;
-	      }
-	      // shift
-	      n_best_tuple keep = n_best_array[size-1];
-	      for ( int ash = size-1; ash > ane; --ash ){
-		n_best_array[ash] = n_best_array[ash-1];
-	      }
-	      n_best_array[ane] = keep;
-	      n_best_array[ane].prob = thisPProb;
-	      n_best_array[ane].path = beam_cnt;
-	      n_best_array[ane].tag = dtag;
+      DBG << "BeamData::NextPath[" << beam_cnt << "] ( " << cl.answer
+	  << " , " << cl.distribution.size() << " tags )" << endl;
+      vector<tag_prob>& Distr = distr;
+      break_down( cl, size, Distr );
+      // the scores of all extensions at once, in log space: the product of
+      // the probabilities along a long sentence underflows
+      int n = min( size, (int)Distr.size() );
+      double *scores = &cand_score[0];
+      for ( int ab=0; ab < n; ++ab ){
+	scores[ab] = log( Distr[ab].prob );
+      }
+      const double base = path_score[beam_cnt];
+      for ( int ab=0; ab < n; ++ab ){
+	scores[ab] += base;
+      }
+      for ( int ab=0; ab < n; ++ab ){
+	double thisPScore = scores[ab];
+	int dtag = Distr[ab].tag;
+	if ( ab > 0 && thisPScore <= n_best_array[size-1].score ){
+	  // apart from the preferred tag in front, Distr is sorted, so
+	  // none of the rest will make it either
+	  break;
+	}
+	if ( signature_depth >= 0 ){
+	  // an entry that agrees on the tags the patterns look at makes
+	  // the same predictions from now on. Keep only the best of those
+	  int same = 0;
+	  while ( same < size
+		  && ( n_best_array[same].path == EMPTY_PATH
+		       || !same_signature( n_best_array[same].path,
+					   n_best_array[same].tag,
+					   beam_cnt, dtag ) ) ){
+	    ++same;
+	  }
+	  if ( same < size ){
+	    if ( thisPScore <= n_best_array[same].score ){
+	      DBG << "Recombine, keep n=" << same << endl;
+	      continue;
+	    }
+	    DBG << "Recombine, drop n=" << same << endl;
+	    for ( int ash = same; ash < size-1; ++ash ){
+	      n_best_array[ash] = n_best_array[ash+1];
 	    }
+	    n_best_array[size-1].clean();
+	  }
+	}
+	for ( int ane = size-1; ane >=0; --ane ){
+	  if ( thisPScore <= n_best_array[ane].score )
+	    break;
+	  if ( ane == 0 ||
+	       thisPScore <= n_best_array[ane-1].score ){
+	    if ( ane == 0 ){
+	      DBG << "Insert, n=0" << endl;
+	    }
+	    else {
+	      DBG << "Insert, n=" << ane << " Score = " << thisPScore
+		  << " after score = " << n_best_array[ane-1].score
+		  << endl;
+	    }
+	    // shift
+	    n_best_tuple keep = n_best_array[size-1];
+	    for ( int ash = size-1; ash > ane; --ash ){
+	      n_best_array[ash] = n_best_array[ash-1];
+	    }
+	    n_best_array[ane] = keep;
+	    n_best_array[ane].score = thisPScore;
+	    n_best_array[ane].path = beam_cnt;
+	    n_best_array[ane].tag = dtag;
 	  }
 	}
-	name_prob_pair *tmp_d_pnt = d_pnt;
-	d_pnt = d_pnt->next;
-	delete tmp_d_pnt;
-	++ab;
       }
     }
   }
 
+  double BeamData::posterior( int beam ) const {
+    /// the share of entry \e beam in the probability mass of the live
+    /// entries at the last position. (log-sum-exp, so no underflow)
+    if ( filled == 0 || tag_at( filled-1, beam ) == EMPTY_PATH ){
+      return 0.0;
+    }
+    const double top = path_score[0];
+    if ( top == NO_SCORE ){
+      return 0.0;
+    }
+    double sum = 0.0;
+    for ( int jb = 0;
+	  jb < size && tag_at( filled-1, jb ) != EMPTY_PATH;
+	  ++jb ){
+      sum += exp( path_score[jb] - top );
+    }
+    return exp( path_score[beam] - top ) / sum;
+  }
+
+  static int left_reach( const PatTemplate& tmpl ){
+    // how far left of the focus the assigned tags ('d' slots) reach
+    int reach = 0;
+    for ( size_t i = 0; i < tmpl.templatestring.size(); ++i ){
+      if ( tmpl.templatestring[i] == 'd' ){
+	reach = max( reach, tmpl.focuspos - (int)i );
+      }
+    }
+    return reach;
+  }
+
   void TaggerClass::InitBeaming( unsigned int no_words ){
     if ( !Beam ){
       Beam = new BeamData();
+      context_depth = max( left_reach( Ktemplate ), left_reach( Utemplate ) );
+      if ( recombine ){
+	Beam->signature_depth = context_depth;
+      }
+      Beam->threshold = beam_threshold;
     }
     Beam->Init( Beam_Size, no_words );
   }
@@ -400,7 +573,7 @@ namespace Tagger {
   //
   // File should contain one word per line.
   //
-  void TaggerClass::read_listfile( const string& FileName, UnicodeHash *words ){
+  void TaggerClass::read_listfile( const string& FileName, SymbolTable *words ){
     UnicodeString wordbuf;
     int no_words=0;
     ifstream wordfile( FileName, ios::in);
@@ -412,19 +585,280 @@ namespace Tagger {
 	<< no_words << " words)." << endl;
   }
 
-  bool TaggerClass::InitTagging( ){
+  void TaggerClass::fill_base_lex(){
+    // Collect all symbols the model can produce in a frozen table, which
+    // is shared between all clones. Symbols that only show up in the test
+    // material (like unknown words, their letters, or tags that were
+    // filtered from the ambitags) go into the per tagger overlay TheLex,
+    // which is emptied for every sentence.
+    BaseLex = new SymbolTable();
+    BaseLex->hash( UNKNOWN );
+    BaseLex->hash( DOT );
+    static const char *hapaxes[] = { "HAPAX-0", "HAPAX-H", "HAPAX-C",
+				     "HAPAX-N", "HAPAX-HC", "HAPAX-HN",
+				     "HAPAX-CN", "HAPAX-HCN" };
+    for ( const auto& h : hapaxes ){
+      BaseLex->hash( h );
+    }
+    static const char *features[] = { "_=", "_H", "_0", "_C", "_N" };
+    for ( const auto& f : features ){
+      BaseLex->hash( f );
+    }
+    for ( const auto& it : *MT_lexicon ){
+      BaseLex->hash( it.first );
+      BaseLex->hash( it.second );
+      vector<UnicodeString> tags = TiCC::split_at( it.second, ";" );
+      for ( const auto& t : tags ){
+	BaseLex->hash( t );
+      }
+      for ( int i=0; i < it.first.length(); ++i ){
+	UnicodeString addChars = "_";
+	addChars += it.first[i];
+	BaseLex->hash( addChars );
+      }
+    }
+    if ( native_known && !init_native_known() ){
+      LOG << "  continuing without --native-known" << endl;
+    }
+    if ( native_unknown && !init_native_unknown() ){
+      LOG << "  continuing without --native-unknown" << endl;
+    }
+    TheLex.set_base( BaseLex );
+    LOG << "  Frozen symbol table holds " << BaseLex->num_of_entries()
+	<< " symbols." << endl;
+  }
+
+  bool TaggerClass::init_native_known(){
+    /// take over the IGTREE Timbl made for the known words
+    /*!
+      Its values and classes are added to BaseLex, so this must run
+      before BaseLex is frozen.
+    */
+    LOG << "  Reading native IGTREE for known words from: " << KnownTreeName
+	<< "... " << endl;
+    NativeKnown = new FlatIGTree();
+    if ( !NativeKnown->read( KnownTreeName, *BaseLex ) ){
+      delete NativeKnown;
+      NativeKnown = 0;
+      return false;
+    }
+    int slots = Ktemplate.totalslots() - Ktemplate.skipfocus;
+    if ( NativeKnown->num_features() != (size_t)slots ){
+      LOG << "  " << KnownTreeName << " has " << NativeKnown->num_features()
+	  << " features, but the known words pattern has " << slots << endl;
+      delete NativeKnown;
+      NativeKnown = 0;
+      return false;
+    }
+    LOG << "  Native IGTREE for known words has "
+	<< NativeKnown->num_nodes() << " nodes." << endl;
+    return true;
+  }
+
+  bool TaggerClass::init_native_unknown(){
+    /// build the indexed IB1 from the compact unknown words case base
+    const string cb_name = UnknownTreeName + ".cb";
+    LOG << "  Reading compact case-base for unknown words from: " << cb_name
+	<< "... " << endl;
+    CaseBase cb;
+    if ( !cb.read( cb_name, *BaseLex ) ){
+      return false;
+    }
+    int slots = Utemplate.totalslots() - Utemplate.skipfocus;
+    if ( cb.num_features != (size_t)slots ){
+      LOG << "  " << cb_name << " has " << cb.num_features
+	  << " features, but the unknown words pattern has " << slots << endl;
+      return false;
+    }
+    NativeUnknown = new NativeIB1( unknown_candidates, unknown_scan );
+    NativeUnknown->build( cb );
+    ib1_scratch = new IB1Scratch();
+    LOG << "  Native IB1 for unknown words holds "
+	<< NativeUnknown->size() << " instances";
+    if ( unknown_scan ){
+      LOG << ", scanned with the " << NativeIB1::kernel_name() << " kernel";
+    }
+    else if ( unknown_candidates > 0 ){
+      LOG << ", at most " << unknown_candidates << " candidates";
+    }
+    LOG << "." << endl;
+    return true;
+  }
+
+  bool plain_ib1_options( const string& opts ){
+    /// are \e opts Timbl's defaults for metric, weighting and k?
+    vector<string> parts = TiCC::split( opts );
+    for ( const auto& p : parts ){
+      if ( p.size() > 1 && p[0] == '-'
+	   && ( p[1] == 'k' || p[1] == 'm' || p[1] == 'w' || p[1] == 'd'
+		|| p[1] == 'q' || p[1] == 'L' ) ){
+	return false;
+      }
+    }
+    return true;
+  }
+
+  bool TaggerClass::load_bundle(){
+    /// take the symbols, the lexicon, the frequent words and the native
+    /// engines from the model bundle, instead of the text files
+    LOG << "  Mapping model bundle: " << BundleName << endl;
+    ModelBundle = new Bundle();
+    if ( !ModelBundle->open( BundleName ) ){
+      return false;
+    }
+    vector<string> strings;
+    if ( !ModelBundle->strings( "symbols", strings ) ){
+      cerr << BundleName << " holds no symbols" << endl;
+      return false;
+    }
+    // the symbols must get the same numbers as when the bundle was made
+    BaseLex = new SymbolTable();
+    for ( size_t i=0; i < strings.size(); ++i ){
+      if ( BaseLex->hash( TiCC::UnicodeFromUTF8( strings[i] ) ) != i+1 ){
+	cerr << BundleName << " holds an invalid symbol table" << endl;
+	return false;
+      }
+    }
+    size_t n = 0;
+    const unsigned int *lex = ModelBundle->array<unsigned int>( "lexicon", n );
+    for ( size_t i=0; i+1 < n; i += 2 ){
+      if ( lex[i] == 0 || lex[i] > strings.size()
+	   || lex[i+1] == 0 || lex[i+1] > strings.size() ){
+	cerr << BundleName << " holds an invalid lexicon" << endl;
+	return false;
+      }
+      MT_lexicon->insert( make_pair( BaseLex->reverse_lookup( lex[i] ),
+				     BaseLex->reverse_lookup( lex[i+1] ) ) );
+    }
+    LOG << "  Lexicon holds " << MT_lexicon->size() << " words." << endl;
+    ModelBundle->strings( "topn", strings );
+    for ( const auto& s : strings ){
+      kwordlist->hash( TiCC::UnicodeFromUTF8( s ) );
+    }
+    if ( native_known ){
+      NativeKnown = new FlatIGTree();
+      if ( !NativeKnown->attach( *ModelBundle, "known" ) ){
+	LOG << "  " << BundleName << " holds no native known words tree, "
+	    << "continuing without --native-known" << endl;
+	delete NativeKnown;
+	NativeKnown = 0;
+      }
+    }
+    if ( native_unknown ){
+      NativeUnknown = new NativeIB1( unknown_candidates, unknown_scan );
+      if ( !NativeUnknown->attach( *ModelBundle, "unknown" ) ){
+	LOG << "  " << BundleName << " holds no native unknown words case "
+	    << "base, continuing without --native-unknown" << endl;
+	delete NativeUnknown;
+	NativeUnknown = 0;
+      }
+      else {
+	ib1_scratch = new IB1Scratch();
+      }
+    }
+    TheLex.set_base( BaseLex );
+    LOG << "  Frozen symbol table holds " << BaseLex->num_of_entries()
+	<< " symbols." << endl;
+    return true;
+  }
+
+  bool TaggerClass::save_bundle( const string& name ){
+    /// store the symbols, the lexicon, the frequent words and the native
+    /// engines in bundle \e name
+    BundleWriter bw;
+    vector<string> strings;
+    for ( unsigned int id=1; id <= BaseLex->num_of_entries(); ++id ){
+      strings.push_back( TiCC::UnicodeToUTF8( BaseLex->reverse_lookup( id ) ) );
+    }
+    bw.add_strings( "symbols", strings );
+    vector<unsigned int> lex;
+    for ( const auto& it : *MT_lexicon ){
+      lex.push_back( BaseLex->lookup( it.first ) );
+      lex.push_back( BaseLex->lookup( it.second ) );
+    }
+    bw.add( "lexicon", lex );
+    strings.clear();
+    for ( unsigned int id=1; id <= kwordlist->num_of_entries(); ++id ){
+      strings.push_back( TiCC::UnicodeToUTF8( kwordlist->reverse_lookup( id ) ) );
+    }
+    bw.add_strings( "topn", strings );
+    if ( NativeKnown ){
+      NativeKnown->save( bw, "known" );
+    }
+    if ( NativeUnknown ){
+      NativeUnknown->save( bw, "unknown" );
+    }
+    return bw.write( name );
+  }
+
+  bool TaggerClass::read_known_tree(){
+    /// read the known words case base, and its weights
+    if ( !KnownTree->GetInstanceBase( KnownTreeName ) ){
+      cerr << "Could not read the known tree from "
+	   << KnownTreeName << endl;
+      return false;
+    }
+    if ( !kwf.empty() && !KnownTree->GetWeights( kwf ) ){
+      cerr << "Couldn't read known weights from " << kwf << endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool TaggerClass::read_unknown_tree() const {
+    /// read the unknown words case base of this tagger. Only once.
+    if ( unknown_loaded ){
+      return true;
+    }
+    lock_guard<mutex> lock( unknown_mutex );
+    if ( !unknown_loaded && unKnownTree ){
+      if ( !unKnownTree->GetInstanceBase( UnknownTreeName ) ){
+	cerr << "Could not read the unknown tree from "
+	     << UnknownTreeName << endl;
+      }
+      else if ( !uwf.empty() && !unKnownTree->GetWeights( uwf ) ){
+	cerr << "Couldn't read unknown weights from " << uwf << endl;
+      }
+      else {
+	unknown_loaded = true;
+      }
+    }
+    return unknown_loaded;
+  }
+
+  bool TaggerClass::ensure_unknown_tree(){
+    /// make sure the unknown words case base can be used
+    /*!
+      With --lazy-unknown, reading it is postponed until the first unknown
+      word, which is a win for short runs on text with few of them.
+      A clone which was made before that, asks the tagger it was cloned
+      from to read it, and then makes its own child experiment. So the
+      case base is read once, whichever clone needs it first.
+    */
+    if ( unknown_loaded ){
+      return true;
+    }
     if ( !cloned ){
+      return read_unknown_tree();
+    }
+    if ( !unknown_master->read_unknown_tree() ){
+      return false;
+    }
+    // making a child experiment reads the parent, don't let two clones
+    // do that at the same time
+    lock_guard<mutex> lock( unknown_master->unknown_mutex );
+    unKnownTree = new TimblAPI( *unknown_master->unKnownTree );
+    unknown_loaded = true;
+    return true;
+  }
+
+  bool TaggerClass::InitTagging( ){
+    if ( !cloned && num_threads == 0 ){
       if ( !cur_log->set_single_threaded_mode() ){
 // 	LOG << "PROBLEM setting to single threaded Failed" << endl;
 // 	LOG << "Tagging might be slower than hoped for" << endl;
       }
     }
-    // read the lexicon
-    //
-    read_lexicon( MTLexFileName );
-    //
-    read_listfile( TopNFileName, kwordlist );
-
     if ( TimblOptStr.empty() ){
       Timbl_Options = "-FColumns ";
     }
@@ -463,52 +897,139 @@ namespace Tagger {
     if ( !unKnownTree->Valid() ){
       return false;
     }
-    // read a previously stored InstanceBase for known words
+    get_weightsfile_name( knownstr, kwf );
+    get_weightsfile_name( unknownstr, uwf );
+    // The case bases don't depend on the lexicon, or on each other. So
+    // they are read in the background, while we read the lexicon
     //
     LOG << "  Reading case-base for known words from: " << KnownTreeName
 	<< "... " << endl;
-    if ( !KnownTree->GetInstanceBase( KnownTreeName) ){
-      cerr << "Could not read the known tree from "
-	   << KnownTreeName << endl;
-      return false;
-    }
-    else {
-      get_weightsfile_name( knownstr, kwf );
-      get_weightsfile_name( unknownstr, uwf );
-      if ( !kwf.empty() ){
-	if ( !KnownTree->GetWeights( kwf ) ){
-	  cerr << "Couldn't read known weights from " << kwf << endl;
-	  return false;
+    bool known_ok = false;
+    exception_ptr known_failure;
+    thread known_loader( [&](){
+	try {
+	  known_ok = read_known_tree();
 	}
-	else {
-	  cerr << "\n  Read known weights from " << kwf << endl;
+	catch ( ... ){
+	  known_failure = current_exception();
 	}
-      }
-      LOG << "  case-base for known words read." << endl;
-      // read  a previously stored InstanceBase for unknown words
-      //
+      } );
+    exception_ptr unknown_failure;
+    thread unknown_loader;
+    if ( lazy_unknown ){
+      LOG << "  The case-base for unknown words will be read from: "
+	  << UnknownTreeName << " when needed" << endl;
+    }
+    else {
       LOG << "  Reading case-base for unknown words from: "
 	  << UnknownTreeName << "... " << endl;
-      if ( !unKnownTree->GetInstanceBase( UnknownTreeName) ){
-	LOG << "Could not read the unknown tree from "
-	     << UnknownTreeName << endl;
-	return false;
-      }
-      else {
-	if ( !uwf.empty() ){
-	  if ( !unKnownTree->GetWeights( uwf ) ){
-	    cerr << "Couldn't read unknown weights from " << uwf << endl;
-	    return false;
+      unknown_loader = thread( [&](){
+	  try {
+	    ensure_unknown_tree();
 	  }
-	  else {
-	    LOG << "\n  Read unknown weights from " << uwf << endl;
+	  catch ( ... ){
+	    unknown_failure = current_exception();
 	  }
-	}
-	LOG << "  case-base for unknown word read" << endl;
+	} );
+    }
+    bool bundle_ok = true;
+    try {
+      if ( bundleflag ){
+	bundle_ok = load_bundle();
+      }
+      else {
+	// read the lexicon
+	//
+	read_lexicon( MTLexFileName );
+	//
+	read_listfile( TopNFileName, kwordlist );
+	//
+	fill_base_lex();
+      }
+    }
+    catch ( ... ){
+      known_loader.join();
+      if ( unknown_loader.joinable() ){
+	unknown_loader.join();
+      }
+      throw;
+    }
+    known_loader.join();
+    if ( unknown_loader.joinable() ){
+      unknown_loader.join();
+    }
+    if ( known_failure ){
+      rethrow_exception( known_failure );
+    }
+    if ( unknown_failure ){
+      rethrow_exception( unknown_failure );
+    }
+    if ( !known_ok || !bundle_ok ){
+      return false;
+    }
+    if ( !kwf.empty() ){
+      LOG << "  Read known weights from " << kwf << endl;
+    }
+    LOG << "  case-base for known words read." << endl;
+    if ( !lazy_unknown ){
+      if ( !unknown_loaded ){
+	return false;
+      }
+      if ( !uwf.empty() ){
+	LOG << "  Read unknown weights from " << uwf << endl;
+      }
+      LOG << "  case-base for unknown word read" << endl;
+    }
+    if ( NativeKnown ){
+      // we walk Timbl's own tree, so only the algorithm matters
+      if ( KnownTree->Algo() != Timbl::IGTREE ){
+	LOG << "  --native-known needs an IGTREE for the known words, "
+	    << "ignored" << endl;
+	delete NativeKnown;
+	NativeKnown = 0;
+      }
+    }
+    if ( NativeUnknown ){
+      // our index only does IB1 with overlap, gain ratio and k=1
+      if ( unKnownTree->Algo() != Timbl::IB1
+	   || !uwf.empty()
+	   || !plain_ib1_options( unknownstr + commonstr ) ){
+	LOG << "  --native-unknown needs IB1 with the default metric, "
+	    << "weighting and k for the unknown words, ignored" << endl;
+	delete NativeUnknown;
+	NativeUnknown = 0;
+	delete ib1_scratch;
+	ib1_scratch = 0;
+      }
+      else if ( distrib_flag || distance_flag ){
+	// the distribution string and the distance are Timbl's own, we
+	// can't make them up
+	LOG << "  --native-unknown is not used together with -v db or -v di"
+	    << endl;
+	delete NativeUnknown;
+	NativeUnknown = 0;
+	delete ib1_scratch;
+	ib1_scratch = 0;
       }
     }
     LOG << "  Sentence delimiter set to '" << EosMark << "'" << endl;
     LOG << "  Beam size = " << Beam_Size << endl;
+    if ( recombine && Beam_Size > 1 ){
+      LOG << "  Recombining beam entries with the same left context" << endl;
+    }
+    if ( beam_threshold > 0.0 && Beam_Size > 1 ){
+      LOG << "  Beam threshold = " << beam_threshold << endl;
+    }
+    if ( beam_budget > 0 && Beam_Size > 1 ){
+      LOG << "  Beam budget per sentence = " << beam_budget << endl;
+    }
+    if ( num_threads > 0 ){
+      LOG << "  Tagging threads = " << num_threads << endl;
+    }
+    if ( cache_size > 0 ){
+      cache = new ClassifyCache( cache_size );
+      LOG << "  Classification cache size = " << cache_size << endl;
+    }
     LOG << "  Known Tree, Algorithm = "
 	<< to_string( KnownTree->Algo() ) << endl;
     LOG << "  Unknown Tree, Algorithm = "
@@ -516,6 +1037,7 @@ namespace Tagger {
     // the testpattern is of the form given in Ktemplate and Utemplate
     // here we allocate enough space for the larger of them to serve both
     //
+    set_classify_needs();
     initialized = true;
     return true;
   }
@@ -562,128 +1084,367 @@ namespace Tagger {
     return result;
   }
 
-#if defined(HAVE_PTHREAD)
-  static pthread_mutex_t timbl_lock = PTHREAD_MUTEX_INITIALIZER;
-#endif
-
   const TargetValue *TaggerClass::Classify( MatchAction Action,
 					    const icu::UnicodeString& teststring,
 					    const ClassDistribution *&distribution,
 					    double& distance ){
+    // no locking needed: a clone has its own Timbl child experiments
+    // only ask Timbl for what we really need
     const TargetValue *answer = 0;
-#if defined(HAVE_PTHREAD)
-    if ( cloned ){
-      pthread_mutex_lock( &timbl_lock );
+    if ( Action != Known && !ensure_unknown_tree() ){
+      throw runtime_error( "Tagger: the unknown words case base couldn't be read" );
     }
-#endif
+    TimblAPI *tree = ( Action == Known ) ? KnownTree : unKnownTree;
+    TiCC::Timer& timer = ( Action == Known ) ? timer2 : timer3;
     timer1.start();
-    if ( Action == Known ){
-      timer2.start();
-      answer = KnownTree->Classify( teststring, distribution, distance );
-      timer2.stop();
+    timer.start();
+    if ( need_distribution && need_distance ){
+      answer = tree->Classify( teststring, distribution, distance );
+    }
+    else if ( need_distribution ){
+      answer = tree->Classify( teststring, distribution );
+    }
+    else if ( need_distance ){
+      answer = tree->Classify( teststring, distance );
     }
     else {
-      timer3.start();
-      answer = unKnownTree->Classify( teststring, distribution, distance );
-      timer3.stop();
+      answer = tree->Classify( teststring );
     }
+    timer.stop();
     timer1.stop();
-#if defined(HAVE_PTHREAD)
-    if ( cloned ){
-      pthread_mutex_unlock( &timbl_lock );
-    }
-#endif
     if ( !answer ){
       throw runtime_error( "Tagger: A classifying problem prevented continuing. Sorry!" );
     }
     return answer;
   }
 
-  void TaggerClass::InitTest( const sentence& mySentence,
-			      const vector<int>& TestPat,
-			      MatchAction Action ){
-    // Now make a testpattern for Timbl to process.
-    UnicodeString test_string = pat_to_string( mySentence, TestPat, Action, 0 );
+  int TaggerClass::target_symbol( const TargetValue *tv ){
+    /// return the symbol number for a Timbl target value
+    /*!
+      Timbl's target values don't change once the case bases are loaded,
+      so we remember the symbols. Except for symbols in the overlay of
+      TheLex, which are only valid during the current sentence.
+    */
+    const auto it = target_symbols.find( tv );
+    if ( it != target_symbols.end() ){
+      return it->second;
+    }
+    int id = TheLex.hash( tv->name() );
+    if ( TheLex.get_base() && TheLex.in_base( id ) ){
+      target_symbols[tv] = id;
+    }
+    return id;
+  }
+
+  void TaggerClass::classify_timbl( MatchAction Action,
+				    const sentence& mySentence,
+				    const vector<int>& TestPat,
+				    int word,
+				    Classification& cl ){
+    // Timbl's API only accepts a pattern as a line of text, so this is
+    // the one place where the pattern is turned into a string.
+    cl.clear();
+    UnicodeString test_string = pat_to_string( mySentence,
+					       TestPat,
+					       Action,
+					       word );
     const ClassDistribution *distribution = 0;
-    double distance;
     const TargetValue *answer = Classify( Action,
 					  test_string,
 					  distribution,
-					  distance );
-    distance_array.resize( mySentence.size() );
-    distribution_array.resize( mySentence.size() );
-    confidence_array.resize( mySentence.size() );
-    if ( distance_flag ){
-      distance_array[0] = distance;
-    }
+					  cl.distance );
+    cl.answer = target_symbol( answer );
     if ( distribution ){
+      cl.distribution.reserve( distribution->size() );
+      for ( const auto& it : *distribution ){
+	cl.distribution.push_back( make_pair( target_symbol( it.second->Value() ),
+					      it.second->Weight() ) );
+      }
       if ( distrib_flag ){
-	distribution_array[0] = distribution->DistToString();
+	cl.dist_string = distribution->DistToString();
       }
       if ( confidence_flag ){
-	confidence_array[0] = distribution->Confidence( answer );
+	cl.confidence = distribution->Confidence( answer );
       }
       if ( IsActive( DBG ) ){
-	LOG << "BeamData::InitPaths( " << mySentence << endl;
-	LOG << " , " << answer << " , " << distribution << " )" << endl;
+	LOG << "Classify: " << answer << " , " << distribution << endl;
       }
     }
-    Beam->InitPaths( TheLex, answer, distribution );
+  }
+
+  void TaggerClass::classify_pattern( MatchAction Action,
+				      const sentence& mySentence,
+				      const vector<int>& TestPat,
+				      int word,
+				      Classification& cl ){
+    /// classify \e TestPat with our own IGTREE or IB1 when we can,
+    /// otherwise with Timbl
+    if ( Action == Unknown
+	 && NativeUnknown
+	 && mySentence.getEnrichments(word).empty() ){
+      // a tie between the nearest neighbours is left to Timbl
+      if ( !check_native ){
+	if ( !NativeUnknown->classify( TestPat, distrib_flag, TheLex,
+				       *ib1_scratch, cl ) ){
+	  ++native_unknown_ties;
+	  classify_timbl( Action, mySentence, TestPat, word, cl );
+	}
+	return;
+      }
+      Classification native;
+      bool decided = NativeUnknown->classify( TestPat, distrib_flag, TheLex,
+					      *ib1_scratch, native );
+      classify_timbl( Action, mySentence, TestPat, word, cl );
+      if ( !decided ){
+	++native_unknown_ties;
+	return;
+      }
+      ++native_unknown_checked;
+      if ( native.answer != cl.answer ){
+	++native_unknown_disagreements;
+	DBG << "Classify: native IB1 differs: " << native.dist_string
+	    << " versus " << cl.dist_string << endl;
+      }
+      return;
+    }
+    if ( Action != Known
+	 || !NativeKnown
+	 || !mySentence.getEnrichments(word).empty() ){
+      classify_timbl( Action, mySentence, TestPat, word, cl );
+      return;
+    }
+    if ( !check_native ){
+      NativeKnown->classify( TestPat, distrib_flag, TheLex, cl );
+      return;
+    }
+    // use Timbl's outcome, but count where we would differ
+    Classification native;
+    NativeKnown->classify( TestPat, distrib_flag, TheLex, native );
+    classify_timbl( Action, mySentence, TestPat, word, cl );
+    ++native_checked;
+    vector<pair<int,double>> d1 = native.distribution;
+    vector<pair<int,double>> d2 = cl.distribution;
+    sort( d1.begin(), d1.end() );
+    sort( d2.begin(), d2.end() );
+    if ( native.answer != cl.answer || d1 != d2 ){
+      ++native_disagreements;
+      DBG << "Classify: native IGTREE differs: " << native.dist_string
+	  << " versus " << cl.dist_string << endl;
+    }
+  }
+
+  void TaggerClass::Classify( MatchAction Action,
+			      const sentence& mySentence,
+			      const vector<int>& TestPat,
+			      int word,
+			      Classification& cl ){
+    /// classify the pattern \e TestPat for word \e word of \e mySentence
+    /*!
+      The outcome is stored in \e cl, in terms of our own symbols.
+    */
+    bool check_it = false;
+    if ( Action == Known &&
+	 ( fast_unambiguous || check_unambiguous ) &&
+	 unambiguous( mySentence.getambitag( word ) ) ){
+      if ( fast_unambiguous ){
+	// the lexicon only knows one tag for this word. take it, and
+	// pretend Timbl was completely sure about it
+	cl.clear();
+	cl.answer = mySentence.getambitag( word );
+	cl.distribution.push_back( make_pair( cl.answer, 1.0 ) );
+	cl.confidence = 1.0;
+	DBG << "Classify: unambiguous " << indexlex( cl.answer, TheLex ) << endl;
+	return;
+      }
+      check_it = true;
+    }
+    bool cacheable = false;
+    if ( cache ){
+      // only patterns made of frozen symbols are worth remembering. the
+      // enrichments are not part of the key, so skip those too.
+      cacheable = mySentence.getEnrichments(word).empty();
+      int slots;
+      if ( Action == Unknown ){
+	slots = Utemplate.totalslots() - Utemplate.skipfocus;
+      }
+      else {
+	slots = Ktemplate.totalslots() - Ktemplate.skipfocus;
+      }
+      cache_key.clear();
+      cache_key.push_back( Action );
+      for ( int f=0; cacheable && f < slots; ++f ){
+	cacheable = TheLex.in_base( TestPat[f] );
+	cache_key.push_back( TestPat[f] );
+      }
+      if ( cacheable && cache->lookup( cache_key, cl ) ){
+	DBG << "Classify: cache hit" << endl;
+      }
+      else {
+	classify_pattern( Action, mySentence, TestPat, word, cl );
+	// Timbl may answer with tags that are not frozen, like the tags
+	// that were filtered from the ambitags. Their numbers in the
+	// overlay mean something else in the next sentence, so those
+	// answers are not kept
+	cacheable = cacheable && TheLex.in_base( cl.answer );
+	for ( const auto& d : cl.distribution ){
+	  cacheable = cacheable && TheLex.in_base( d.first );
+	}
+	if ( cacheable ){
+	  cache->store( cache_key, cl );
+	}
+      }
+    }
+    else {
+      classify_pattern( Action, mySentence, TestPat, word, cl );
+    }
+    if ( check_it ){
+      // the fast path answers with just the lexicon tag. that only gives
+      // the same beam scores and confidence as Timbl when Timbl's
+      // distribution holds nothing else
+      ++unambiguous_checked;
+      if ( cl.answer != mySentence.getambitag( word )
+	   || cl.distribution.size() != 1 ){
+	++unambiguous_disagreements;
+      }
+    }
+  }
+
+  bool TaggerClass::unambiguous( int ambitag ){
+    /// does the ambitag \e ambitag consist of just one tag?
+    return TheLex.in_base( ambitag )
+      && indexlex( ambitag, TheLex ).indexOf( ';' ) == -1;
+  }
+
+  void TaggerClass::InitTest( const sentence& mySentence,
+			      const vector<int>& TestPat,
+			      MatchAction Action ){
+    // Now make a testpattern for Timbl to process.
+    Classify( Action, mySentence, TestPat, 0, classification );
+    distance_array.resize( mySentence.size() );
+    distribution_array.resize( mySentence.size() );
+    confidence_array.resize( mySentence.size() );
+    topk_array.resize( mySentence.size() );
+    store_outputs( classification, 0 );
+    if ( IsActive( DBG ) ){
+      LOG << "BeamData::InitPaths( " << mySentence << " )" << endl;
+    }
+    Beam->InitPaths( classification );
     if ( IsActive( DBG ) ){
       Beam->Print( LOG, 0, TheLex );
     }
   }
 
 
-  bool TaggerClass::NextBest( const sentence& mySentence,
-			      vector<int>& TestPat,
+  int TaggerClass::NextBests( const sentence& mySentence,
 			      int i_word,
-			      int beam_cnt ){
+			      int width ){
+    /// extend at most \e width paths in the beam with word \e i_word
+    /*!
+      First the patterns for all live paths are made. Paths often share
+      the same left context, so identical patterns are classified only
+      once. Then the outcomes are handed to the beam, in beam order.
+      \return the number of paths extended
+    */
     MatchAction Action = Unknown;
-    if ( Beam->paths[beam_cnt][i_word-1] == EMPTY_PATH ){
-      return false;
+    int live = 0;
+    for ( int beam_cnt=0; beam_cnt < width; ++beam_cnt ){
+      if ( Beam->tag_at( i_word-1, beam_cnt ) == EMPTY_PATH ){
+	break;
+      }
+      if ( (int)beam_patterns.size() <= beam_cnt ){
+	beam_patterns.resize( beam_cnt+1 );
+      }
+      vector<int>& TestPat = beam_patterns[beam_cnt];
+      Action = Unknown;
+      if ( !mySentence.nextpat( Action, TestPat,
+				*kwordlist, TheLex,
+				i_word,
+				Beam->Context( beam_cnt, i_word,
+					       context_depth ) ) ){
+	break;
+      }
+      ++live;
     }
-    else if ( !mySentence.nextpat( Action, TestPat,
-				   *kwordlist, TheLex,
-				   i_word, Beam->paths[beam_cnt] ) ){
-      return false;
+    beam_unique.resize( live );
+    if ( (int)beam_results.size() < live ){
+      beam_results.resize( live );
     }
-    else {
-      // Now make a testpattern for Timbl to process.
-      UnicodeString test_string = pat_to_string( mySentence,
-						 TestPat,
-						 Action,
-						 i_word );
-      // process test_string to predict a category, using the
-      // appropriate tree
-      //
-      //      cerr << "test_string '" << test_string << "'" << endl;
-      const ClassDistribution *distribution = 0;
-      double distance;
-      const TargetValue *answer = Classify( Action, test_string,
-					    distribution, distance );
+    for ( int beam_cnt=0; beam_cnt < live; ++beam_cnt ){
+      int same = 0;
+      while ( same < beam_cnt
+	      && beam_patterns[same] != beam_patterns[beam_cnt] ){
+	++same;
+      }
+      beam_unique[beam_cnt] = same;
+      if ( same == beam_cnt ){
+	// process the testpattern to predict a category, using the
+	// appropriate tree
+	//
+	Classify( Action, mySentence, beam_patterns[beam_cnt], i_word,
+		  beam_results[beam_cnt] );
+      }
+      else {
+	DBG << "beam " << beam_cnt << " has the same pattern as beam "
+	    << same << endl;
+      }
+    }
+    for ( int beam_cnt=0; beam_cnt < live; ++beam_cnt ){
+      const Classification& cl = beam_results[beam_unique[beam_cnt]];
       if ( beam_cnt == 0 ){
-	if ( distance_flag ){
-	  distance_array[i_word] = distance;
-	}
-	if ( distribution ){
-	  if ( distrib_flag ){
-	    distribution_array[i_word] = distribution->DistToString();
-	  }
-	  if ( confidence_flag ){
-	    confidence_array[i_word] = distribution->Confidence( answer );
-	  }
-	}
+	store_outputs( cl, i_word );
       }
       if ( IsActive( DBG ) ){
-	LOG << "BeamData::NextPaths( " << mySentence << endl;
-	LOG << " , " << answer << " , " << distribution << " )" << endl;
+	LOG << "BeamData::NextPaths( " << mySentence << " )" << endl;
       }
-      Beam->NextPath( TheLex, answer, distribution, beam_cnt );
+      Beam->NextPath( cl, beam_cnt );
       if ( IsActive( DBG ) ){
 	Beam->PrintBest( LOG, TheLex );
       }
-      return true;
+    }
+    return live;
+  }
+
+  void TaggerClass::set_classify_needs(){
+    /// work out what a classification must deliver, besides the answer
+    /*!
+      A beam needs the distribution to extend its paths, and so do the
+      -v db, -v cf and -v tk outputs, --check-native and
+      --check-unambiguous. The distance is only needed for -v di.
+    */
+    need_distribution = Beam_Size > 1
+      || distrib_flag || confidence_flag || topk_size > 0 || check_native
+      || check_unambiguous;
+    need_distance = distance_flag;
+    if ( fast_unambiguous && ( distrib_flag || distance_flag ) ){
+      // the distribution string and the distance are Timbl's own, we
+      // can't make them up
+      LOG << "  --fast-unambiguous is not used together with -v db or -v di"
+	  << endl;
+      fast_unambiguous = false;
+    }
+  }
+
+  void TaggerClass::store_outputs( const Classification& cl, int i_word ){
+    /// remember the requested outputs of word \e i_word
+    if ( distance_flag ){
+      distance_array[i_word] = cl.distance;
+    }
+    if ( !cl.distribution.empty() ){
+      if ( distrib_flag ){
+	distribution_array[i_word] = cl.dist_string;
+      }
+      if ( confidence_flag ){
+	confidence_array[i_word] = cl.confidence;
+      }
+    }
+    if ( topk_size > 0 ){
+      vector<tag_prob>& Distr = topk_scratch;
+      break_down( cl, topk_size, Distr );
+      auto& top = topk_array[i_word];
+      top.clear();
+      for ( int k=0; k < topk_size && k < (int)Distr.size(); ++k ){
+	top.push_back( make_pair( Distr[k].tag, Distr[k].prob ) );
+      }
     }
   }
 
@@ -727,6 +1488,16 @@ namespace Tagger {
       if ( distance_is_set() ){
 	one_entry["distance"] = tr.distance();
       }
+      if ( top_k_size() > 0 ){
+	json top = json::array();
+	for ( const auto& tp : tr.top_k() ){
+	  json one_tag;
+	  one_tag["tag"] = TiCC::UnicodeToUTF8( tp.first );
+	  one_tag["prob"] = tp.second;
+	  top.push_back( one_tag );
+	}
+	one_entry["top_k"] = top;
+      }
       result.push_back( one_entry );
     }
     return result;
@@ -783,6 +1554,8 @@ namespace Tagger {
       throw runtime_error( "Tagger not initialized" );
     }
     if ( mySentence.size() != 0 ){
+      // forget the symbols of the previous sentence
+      TheLex.clear();
       InitBeaming( mySentence.size() );
       DBG << mySentence << endl;
       if ( mySentence.init_windowing( *MT_lexicon, TheLex ) ) {
@@ -795,16 +1568,25 @@ namespace Tagger {
 	if ( mySentence.nextpat( Action, TestPat, *kwordlist, TheLex, 0, start )){
 	  DBG << "Start: " << mySentence.getword( 0 ) << endl;
 	  InitTest( mySentence, TestPat, Action );
+	  // the classification of the first word counts too
+	  size_t spent = 1;
 	  for ( unsigned int iword=1; iword < mySentence.size(); ++iword ){
+	    int width = Beam_Size;
+	    if ( beam_budget > 0 ){
+	      // keep one expansion for each of the words still to come
+	      size_t after = mySentence.size() - iword - 1;
+	      size_t left = beam_budget > spent + after
+		? beam_budget - spent - after : 1;
+	      width = (int)min( left, (size_t)Beam_Size );
+	    }
 	    // clear best_array
 	    DBG << endl << "Next: " << mySentence.getword( iword ) << endl;
 	    Beam->ClearBest();
-	    for ( int beam_count=0; beam_count < Beam_Size; ++beam_count ){
-	      if ( !NextBest( mySentence, TestPat, iword, beam_count ) ){
-		break;
-	      }
-	    }
-	    Beam->Shift( mySentence.size(), iword );
+	    int live = NextBests( mySentence, iword, width );
+	    spent += live;
+	    beam_expanded += live;
+	    ++beam_positions;
+	    Beam->Shift( iword );
 	    if ( IsActive( DBG ) ){
 	      LOG << "after shift:" << endl;
 	      Beam->Print( LOG, iword, TheLex );
@@ -812,6 +1594,7 @@ namespace Tagger {
 	  }
 	} // end one sentence
       }
+      const vector<int>& best = Beam->Backtrace();
       // get output
       for ( unsigned int Wcnt=0; Wcnt < mySentence.size(); ++Wcnt ){
 	TagResult res;
@@ -820,7 +1603,7 @@ namespace Tagger {
 	// get the original tag
 	res._input_tag = mySentence.gettag(Wcnt);
 	// lookup the assigned tag
-	res._tag = indexlex( Beam->paths[0][Wcnt], TheLex );
+	res._tag = indexlex( best[Wcnt], TheLex );
 	// is it known/unknown
 	res._known = mySentence.known(Wcnt);
 	if ( input_kind == ENRICHED ){
@@ -835,12 +1618,85 @@ namespace Tagger {
 	if ( distance_flag ){
 	  res._distance = distance_array[Wcnt];
 	}
+	if ( topk_size > 0 ){
+	  // the tags must be looked up before TheLex is cleared
+	  for ( const auto& tp : topk_array[Wcnt] ){
+	    res._top_k.push_back( make_pair( indexlex( tp.first, TheLex ),
+					     tp.second ) );
+	  }
+	}
 	result.push_back( res );
       }
     } // end of output loop through one sentence
     return result;
   }
 
+  vector<vector<TagResult>> TaggerClass::tagSentences( const vector<sentence*>& sents,
+						       int threads ){
+    /// tag a batch of sentences, using \e threads clones
+    /*!
+      The sentences are scheduled on the clones with a work-stealing
+      scheduler, so some very long sentences don't keep the other threads
+      waiting. The clones and the threads of the scheduler are kept for
+      the next batch.
+      \return the results, in the order of \e sents
+    */
+    vector<vector<TagResult>> result( sents.size() );
+    if ( threads <= 1 || sents.size() <= 1 ){
+      for ( size_t i=0; i < sents.size(); ++i ){
+	result[i] = tagSentence( *sents[i] );
+      }
+      return result;
+    }
+    while ( batch_workers.size() < (size_t)threads ){
+      batch_workers.push_back( clone() );
+    }
+    if ( !batch_scheduler || batch_scheduler->size() != (size_t)threads ){
+      delete batch_scheduler;
+      batch_scheduler = new TaskScheduler( threads );
+    }
+    // the cost of a sentence grows with its length times the beam size
+    vector<size_t> costs;
+    for ( const auto& s : sents ){
+      costs.push_back( s->size() * Beam_Size );
+    }
+    batch_scheduler->run( costs,
+			  [&]( size_t worker, size_t task ){
+			    result[task] = batch_workers[worker]->tagSentence( *sents[task] );
+			  } );
+    DBG << "tagSentences: " << batch_scheduler->steals()
+	<< " tasks were stolen" << endl;
+    return result;
+  }
+
+  vector<vector<TagResult>> TaggerClass::tagLines( const vector<UnicodeString>& lines,
+						   int threads ){
+    /// tag a batch of lines, like tagLine(), using \e threads clones
+    vector<sentence*> sents;
+    for ( const auto& line : lines ){
+      sentence *sent = new sentence( Ktemplate, Utemplate );
+      stringstream ss;
+      ss << line;
+      size_t dummy = 0;
+      sent->read( ss, input_kind, EosMark, Separators, dummy );
+      sents.push_back( sent );
+    }
+    vector<vector<TagResult>> result;
+    try {
+      result = tagSentences( sents, threads );
+    }
+    catch ( ... ){
+      for ( const auto& s : sents ){
+	delete s;
+      }
+      throw;
+    }
+    for ( const auto& s : sents ){
+      delete s;
+    }
+    return result;
+  }
+
   UnicodeString decode( const UnicodeString& eom ){
     if ( eom  == "EL" ){
       return "";
@@ -911,7 +1767,7 @@ namespace Tagger {
     UnicodeString tagstring;
     //now some output
     for ( unsigned int Wcnt=0; Wcnt < mySentence.size(); ++Wcnt ){
-      tagstring = indexlex( Beam->paths[0][Wcnt], TheLex );
+      tagstring = indexlex( Beam->best_path[Wcnt], TheLex );
       if ( mySentence.known(Wcnt) ){
 	no_known++;
 	if ( input_kind != UNTAGGED ){
@@ -932,6 +1788,9 @@ namespace Tagger {
   }
 
   int TaggerClass::ProcessFile( istream& infile, ostream& outfile ){
+    if ( num_threads > 0 ){
+      return ProcessFileParallel( infile, outfile );
+    }
     int no_words=0;
     int no_correct_known=0;
     int no_correct_unknown=0;
@@ -969,16 +1828,314 @@ namespace Tagger {
 	  // probably empty sentence??
       }
     } // end of while looping over sentences
+    show_statistics( no_words,
+		     no_known, no_unknown,
+		     no_correct_known, no_correct_unknown,
+		     true );
+    return no_words;
+  }
+
+  struct worker_counts {
+    /// the statistics gathered by one thread of ProcessFileParallel()
+    worker_counts():
+      no_words(0), no_known(0), no_unknown(0),
+      no_correct_known(0), no_correct_unknown(0) {};
+    int no_words;
+    int no_known;
+    int no_unknown;
+    int no_correct_known;
+    int no_correct_unknown;
+  };
+
+  template <typename T>
+  class bounded_queue {
+    /// a FIFO queue holding at most \e capacity items
+    /*!
+      push() blocks while the queue is full, pop() blocks while it is empty.
+      After close() no more items are accepted, and pop() fails as soon as
+      the queue is drained.
+    */
+  public:
+    explicit bounded_queue( size_t cap ): capacity(cap), closed(false) {};
+    bool push( T item ){
+      unique_lock<mutex> lock( mtx );
+      not_full.wait( lock, [this]{ return closed || items.size() < capacity; } );
+      if ( closed ){
+	return false;
+      }
+      items.push_back( item );
+      not_empty.notify_one();
+      return true;
+    }
+    bool pop( T& item ){
+      unique_lock<mutex> lock( mtx );
+      not_empty.wait( lock, [this]{ return closed || !items.empty(); } );
+      if ( items.empty() ){
+	return false;
+      }
+      item = items.front();
+      items.pop_front();
+      not_full.notify_one();
+      return true;
+    }
+    void close(){
+      lock_guard<mutex> lock( mtx );
+      closed = true;
+      not_full.notify_all();
+      not_empty.notify_all();
+    }
+    deque<T> items;
+  private:
+    size_t capacity;
+    bool closed;
+    mutex mtx;
+    condition_variable not_full;
+    condition_variable not_empty;
+  };
+
+  template <typename T>
+  class ordered_buffer {
+    /// collects numbered items, which may arrive in any order
+    /*!
+      get() returns the items in order of their sequence number.
+      put() blocks while an item is more than \e window places ahead of the
+      next item to deliver, so the buffer never holds more than \e window
+      items.
+    */
+  public:
+    explicit ordered_buffer( size_t win ):
+      window(win), next(0), producers_done(false) {};
+    bool put( size_t seq, T item ){
+      unique_lock<mutex> lock( mtx );
+      has_room.wait( lock, [&]{ return producers_done || seq < next + window; } );
+      if ( producers_done ){
+	return false;
+      }
+      pending[seq] = item;
+      has_next.notify_all();
+      return true;
+    }
+    bool get( T& item ){
+      unique_lock<mutex> lock( mtx );
+      has_next.wait( lock, [this]{
+	  return producers_done || pending.find( next ) != pending.end(); } );
+      auto it = pending.find( next );
+      if ( it == pending.end() ){
+	return false;
+      }
+      item = it->second;
+      pending.erase( it );
+      ++next;
+      has_room.notify_all();
+      return true;
+    }
+    void finish(){
+      lock_guard<mutex> lock( mtx );
+      producers_done = true;
+      has_room.notify_all();
+      has_next.notify_all();
+    }
+    map<size_t,T> pending;
+  private:
+    size_t window;
+    size_t next;
+    bool producers_done;
+    mutex mtx;
+    condition_variable has_room;
+    condition_variable has_next;
+  };
 
+  struct pipe_item {
+    /// a sentence travelling through the ProcessFileParallel() pipeline
+    pipe_item( size_t n, sentence *s ): seq(n), sent(s) {};
+    ~pipe_item(){ delete sent; };
+    size_t seq;
+    sentence *sent;
+    vector<TagResult> result;
+  };
+
+  int TaggerClass::ProcessFileParallel( istream& infile, ostream& outfile ){
+    /// tag the sentences from \e infile in a reader/tagger/writer pipeline
+    /*!
+      A reader thread parses sentences from \e infile into a bounded queue.
+      \e num_threads tagger threads, each with their own clone, take
+      sentences from that queue and tag them. The calling thread converts
+      the results to text and writes them to \e outfile, in the original
+      input order.
+      All buffers are bounded, so a slow stage stalls the earlier ones,
+      and memory use stays flat, even on endless input.
+    */
+    const size_t queue_size = 16 * num_threads;
+    bounded_queue<pipe_item*> in_queue( queue_size );
+    ordered_buffer<pipe_item*> out_buffer( 2 * queue_size );
+    vector<TaggerClass*> workers( num_threads );
+    vector<worker_counts> counts( num_threads );
+    // the failures of the taggers, the reader and the writer
+    vector<exception_ptr> failures( num_threads + 2 );
+    for ( auto& w : workers ){
+      w = clone();
+    }
+    thread reader( [&]{
+	try {
+	  int HartBeat = 0;
+	  size_t line_cnt = 0;
+	  size_t seq = 0;
+	  sentence mySentence( Ktemplate, Utemplate );
+	  while ( mySentence.read( infile, input_kind,
+				   EosMark, Separators, line_cnt ) ){
+	    if ( mySentence.size() == 0 ){
+	      continue;
+	    }
+	    if ( ++HartBeat % 100 == 0 ) {
+	      cerr << "."; cerr.flush();
+	    }
+	    sentence *sent = new sentence( Ktemplate, Utemplate );
+	    sent->take_over( mySentence );
+	    pipe_item *item = new pipe_item( seq, sent );
+	    if ( !in_queue.push( item ) ){
+	      // the pipeline is shut down
+	      delete item;
+	      break;
+	    }
+	    ++seq;
+	  }
+	}
+	catch ( ... ){
+	  failures[num_threads] = current_exception();
+	}
+	in_queue.close();
+      } );
+    vector<thread> taggers;
+    atomic<int> running( num_threads );
+    for ( int t=0; t < num_threads; ++t ){
+      taggers.push_back( thread( [&,t]{
+	    TaggerClass *worker = workers[t];
+	    worker_counts& wc = counts[t];
+	    pipe_item *item = 0;
+	    try {
+	      while ( in_queue.pop( item ) ){
+		sentence& sent = *item->sent;
+		if ( sent.getword(0) != EosMark ){
+		  item->result = worker->tagSentence( sent );
+		  if ( !item->result.empty() ){
+		    worker->statistics( sent,
+					wc.no_known, wc.no_unknown,
+					wc.no_correct_known,
+					wc.no_correct_unknown );
+		    wc.no_words += sent.size();
+		  }
+		}
+		// else only possible for ENRICHED!
+		if ( !out_buffer.put( item->seq, item ) ){
+		  delete item;
+		  break;
+		}
+		item = 0;
+	      }
+	    }
+	    catch ( ... ){
+	      delete item;
+	      failures[t] = current_exception();
+	      // shut down the pipeline
+	      in_queue.close();
+	      out_buffer.finish();
+	    }
+	    if ( --running == 0 ){
+	      out_buffer.finish();
+	    }
+	  } ) );
+    }
+    // write the results
+    pipe_item *item = 0;
+    try {
+      while ( out_buffer.get( item ) ){
+	if ( item->sent->getword(0) == EosMark ){
+	  outfile << EosMark << endl;
+	}
+	else {
+	  UnicodeString tagged_sentence = TRtoString( item->result );
+	  if ( !tagged_sentence.isEmpty() ){
+	    outfile << tagged_sentence << endl;
+	  }
+	}
+	delete item;
+	item = 0;
+      }
+    }
+    catch ( ... ){
+      delete item;
+      failures[num_threads+1] = current_exception();
+      // shut down the pipeline, so the threads below can be joined
+      in_queue.close();
+      out_buffer.finish();
+    }
+    reader.join();
+    for ( auto& th : taggers ){
+      th.join();
+    }
+    // cleanup what is left after a failure
+    for ( const auto& it : in_queue.items ){
+      delete it;
+    }
+    for ( const auto& it : out_buffer.pending ){
+      delete it.second;
+    }
+    for ( const auto& w : workers ){
+      if ( cache ){
+	cache->add_counts( *w->cache );
+      }
+      unambiguous_checked += w->unambiguous_checked;
+      unambiguous_disagreements += w->unambiguous_disagreements;
+      native_checked += w->native_checked;
+      native_disagreements += w->native_disagreements;
+      native_unknown_checked += w->native_unknown_checked;
+      native_unknown_disagreements += w->native_unknown_disagreements;
+      native_unknown_ties += w->native_unknown_ties;
+      beam_expanded += w->beam_expanded;
+      beam_positions += w->beam_positions;
+      delete w;
+    }
+    for ( const auto& f : failures ){
+      if ( f ){
+	rethrow_exception( f );
+      }
+    }
+    // merge the counts of all workers
+    worker_counts total;
+    for ( const auto& wc : counts ){
+      total.no_words += wc.no_words;
+      total.no_known += wc.no_known;
+      total.no_unknown += wc.no_unknown;
+      total.no_correct_known += wc.no_correct_known;
+      total.no_correct_unknown += wc.no_correct_unknown;
+    }
+    // the Timbl statistics are spread over the clones, so don't show them
+    show_statistics( total.no_words,
+		     total.no_known, total.no_unknown,
+		     total.no_correct_known, total.no_correct_unknown,
+		     false );
+    return total.no_words;
+  }
+
+  void TaggerClass::show_statistics( int no_words,
+				     int no_known,
+				     int no_unknown,
+				     int no_correct_known,
+				     int no_correct_unknown,
+				     bool timbl_stats ){
     cerr << endl << endl << "Done: " << no_words
 	 << " words processed." << endl << endl;
     if ( no_words > 0 ){
       if ( input_kind != UNTAGGED ){
 	cerr << "Classification Statistics:" << endl;
-	cerr << endl << "  Known Words:" << endl;
-	KnownTree->ShowStatistics(cerr);
-	cerr << endl << "  UnKnown Words:" << endl;
-	unKnownTree->ShowStatistics(cerr);
+	if ( timbl_stats ){
+	  cerr << endl << "  Known Words:" << endl;
+	  KnownTree->ShowStatistics(cerr);
+	  if ( unknown_loaded ){
+	    cerr << endl << "  UnKnown Words:" << endl;
+	    unKnownTree->ShowStatistics(cerr);
+	  }
+	}
 	cerr << endl
 	     << "  Total        : " << no_correct_known+no_correct_unknown
 	     << "\tcorrect from " << no_known+no_unknown << " ("
@@ -997,11 +2154,61 @@ namespace Tagger {
 	cerr << endl;
 	cerr << "  Total        : " << no_known+no_unknown << endl;
       }
+      if ( cache ){
+	size_t lookups = cache->hits() + cache->misses();
+	cerr << endl << "Classification cache (size " << cache->capacity()
+	     << "): " << cache->hits() << " hits, "
+	     << cache->misses() << " misses";
+	if ( lookups > 0 ){
+	  cerr << " (" << ((float)cache->hits()/(float)lookups)*100
+	       << " % hits)";
+	}
+	cerr << endl;
+      }
+      if ( check_unambiguous ){
+	cerr << endl << "Unambiguous known words: Timbl disagreed with the "
+	     << "lexicon for " << unambiguous_disagreements << " of "
+	     << unambiguous_checked << " classifications";
+	if ( unambiguous_checked > 0 ){
+	  cerr << " (" << ((float)unambiguous_disagreements/(float)unambiguous_checked)*100
+	       << " %)";
+	}
+	cerr << endl;
+      }
+      if ( check_native && NativeKnown ){
+	cerr << endl << "Known words: the native IGTREE disagreed with Timbl "
+	     << "for " << native_disagreements << " of "
+	     << native_checked << " classifications";
+	if ( native_checked > 0 ){
+	  cerr << " (" << ((float)native_disagreements/(float)native_checked)*100
+	       << " %)";
+	}
+	cerr << endl;
+      }
+      if ( check_native && NativeUnknown ){
+	cerr << endl << "Unknown words: the indexed IB1 disagreed with Timbl "
+	     << "for " << native_unknown_disagreements << " of "
+	     << native_unknown_checked << " classifications";
+	if ( native_unknown_checked > 0 ){
+	  cerr << " (" << ((float)native_unknown_disagreements/(float)native_unknown_checked)*100
+	       << " %)";
+	}
+	cerr << endl;
+      }
+      if ( NativeUnknown && native_unknown_ties > 0 ){
+	cerr << endl << "Unknown words: " << native_unknown_ties
+	     << " ties between the nearest neighbours were left to Timbl"
+	     << endl;
+      }
+      if ( Beam_Size > 1 && beam_positions > 0 ){
+	cerr << endl << "Beam: extended on average "
+	     << (float)beam_expanded/(float)beam_positions
+	     << " of " << Beam_Size << " paths for " << beam_positions
+	     << " word positions" << endl;
+      }
     }
-    return no_words;
   }
 
-
   bool TaggerClass::readsettings( string& fname ){
     ifstream setfile( fname, ios::in);
     if ( !setfile ){
@@ -1017,6 +2224,18 @@ namespace Tagger {
 	  Beam_Size = 1;
 	}
 	break;
+      case 'b':
+	sscanf(SetBuffer,"b %300s", value );
+	BundleBaseName = value;
+	BundleName = prefixWithAbsolutePath( BundleBaseName,
+					     SettingsFilePath );
+	bundleflag = true; // there is a model bundle
+	break;
+      case 'C':
+	if ( sscanf(SetBuffer,"C %40zu", &cache_size ) != 1 ){
+	  cache_size = 0;
+	}
+	break;
       case 'd':
 	dumpflag=true;
 	cerr << "  Dumpflag ON" << endl;
@@ -1111,10 +2330,10 @@ namespace Tagger {
       case 'D':
 	double dvalue;
 	sscanf( SetBuffer,"DATA_VERSION %lf", &dvalue );
-	if ( dvalue < DataVersion() ){
+	if ( dvalue < MinDataVersion() ){
 	  cerr << fname << " has a PROBLEM!" << endl
 	       << "the DATA_VERSION is " << dvalue << endl
-	       << "but this version of MbT expects at least " << DataVersion()
+	       << "but this version of MbT expects at least " << MinDataVersion()
 	       << endl;
 	  return false;
 	}
@@ -1129,7 +2348,7 @@ namespace Tagger {
     if ( data_value == 0.0 ){
       cerr << fname << " has a PROBLEM!" << endl
 	   << "No DATA_VERSION setting is found but this version of MbT expects"
-	   << " at least " << DataVersion() << endl;
+	   << " at least " << MinDataVersion() << endl;
       return false;
     }
     return true;
@@ -1194,6 +2413,80 @@ namespace Tagger {
     if ( Opts.extract( "tabbed" ) ){
       Separators = "\t";
     }
+    if ( Opts.extract( 'j', value ) ){
+      int threads = stringTo<int>(value);
+      if ( threads > 0 ){
+	num_threads = threads;
+      }
+      else {
+	num_threads = 0;
+      }
+    };
+    if ( Opts.extract( "cache", value ) ){
+      if ( !stringTo<size_t>( value, cache_size ) ){
+	cerr << "invalid value for --cache: " << value << endl;
+	return false;
+      }
+    }
+    if ( Opts.extract( "fast-unambiguous" ) ){
+      fast_unambiguous = true;
+    }
+    if ( Opts.extract( "check-unambiguous" ) ){
+      check_unambiguous = true;
+    }
+    if ( fast_unambiguous && check_unambiguous ){
+      cerr << "--fast-unambiguous and --check-unambiguous can't be combined"
+	   << endl;
+      return false;
+    }
+    if ( Opts.extract( "lazy-unknown" ) ){
+      lazy_unknown = true;
+    }
+    if ( Opts.extract( "recombine" ) ){
+      recombine = true;
+    }
+    if ( Opts.extract( "beam-threshold", value ) ){
+      if ( !stringTo<double>( value, beam_threshold )
+	   || beam_threshold < 0.0 || beam_threshold >= 1.0 ){
+	cerr << "invalid value for --beam-threshold: " << value
+	     << " (should be at least 0 and below 1)" << endl;
+	return false;
+      }
+    }
+    if ( Opts.extract( "beam-budget", value ) ){
+      if ( !stringTo<size_t>( value, beam_budget ) ){
+	cerr << "invalid value for --beam-budget: " << value << endl;
+	return false;
+      }
+    }
+    if ( Opts.extract( "native-known" ) ){
+      native_known = true;
+    }
+    if ( Opts.extract( "native-unknown" ) ){
+      native_unknown = true;
+    }
+    if ( Opts.extract( "unknown-candidates", value ) ){
+      if ( !stringTo<size_t>( value, unknown_candidates ) ){
+	cerr << "invalid value for --unknown-candidates: " << value << endl;
+	return false;
+      }
+      native_unknown = true;
+    }
+    if ( Opts.extract( "unknown-scan" ) ){
+      native_unknown = true;
+      unknown_scan = true;
+    }
+    if ( unknown_scan && unknown_candidates > 0 ){
+      cerr << "--unknown-scan and --unknown-candidates can't be combined"
+	   << endl;
+      return false;
+    }
+    if ( Opts.extract( "check-native" ) ){
+      if ( !native_unknown ){
+	native_known = true;
+      }
+      check_native = true;
+    }
     if ( Opts.extract( 'k', value ) ){
       KnownTreeName = value;
       knowntreeflag = true; // there is a knowntreefile specified
@@ -1256,6 +2549,12 @@ namespace Tagger {
 	else if ( o == "cf" ){
 	  confidence_flag = true;
 	}
+	else if ( o.compare( 0, 2, "tk" ) == 0 ){
+	  if ( !stringTo<int>( o.substr( 2 ), topk_size ) || topk_size < 1 ){
+	    cerr << "invalid value for -v tk<n>: " << o << endl;
+	    return false;
+	  }
+	}
       }
     };
     if ( cloned && input_kind == ENRICHED ){
@@ -1290,8 +2589,8 @@ namespace Tagger {
 	 << endl << endl;
   }
 
-  const std::string mbt_short_opts = "hv:VB:dD:e:k:l:L:o:O:r:s:t:E:T:u:";
-  const std::string mbt_long_opts  = "help,version,settings:,tabbed";
+  const std::string mbt_short_opts = "hv:VB:dD:e:j:k:l:L:o:O:r:s:t:E:T:u:";
+  const std::string mbt_long_opts  = "help,version,settings:,tabbed,cache:,fast-unambiguous,check-unambiguous,native-known,native-unknown,unknown-candidates:,unknown-scan,check-native,lazy-unknown,recombine,beam-threshold:,beam-budget:";
 
   void TaggerClass::run_usage( const string& progname ){
     cerr << "Usage is : " << progname << " option option ... \n"
@@ -1314,9 +2613,35 @@ namespace Tagger {
 	 << "\t  U: <options>   options to use for Unknown Words Case Base\n"
 	 << "\t  valid Timbl options: a d k m q v w x -\n"
 	 << "\t-B <beamsize for search> (default = 1) \n"
+	 << "\t--recombine keep only the best of the beam entries that end\n"
+	 << "\t   in the same tags, as far as the patterns look back\n"
+	 << "\t--beam-threshold=<f> drop beam entries less than <f> times as\n"
+	 << "\t   probable as the best one. (default 0: keep all)\n"
+	 << "\t--beam-budget=<n> extend at most <n> beam entries per sentence,\n"
+	 << "\t   but at least one per word. (default 0: no limit)\n"
+	 << "\t-j <number of tagging threads> read, tag and write in a pipeline\n"
+	 << "\t   (default: no pipeline, tag in the main thread) \n"
+	 << "\t--lazy-unknown read the unknown words case base only when the\n"
+	 << "\t   first unknown word shows up\n"
+	 << "\t--cache=<size> remember the classifications of at most <size>\n"
+	 << "\t   patterns (per tagging thread). (default 0: no cache)\n"
+	 << "\t--fast-unambiguous assign the tag directly to known words with\n"
+	 << "\t   only one tag in the lexicon, without consulting Timbl\n"
+	 << "\t--check-unambiguous report how often Timbl disagrees with the\n"
+	 << "\t   lexicon for those words\n"
+	 << "\t--native-known classify known words with our own flat copy of\n"
+	 << "\t   Timbl's known words IGTREE\n"
+	 << "\t--native-unknown classify unknown words with an indexed IB1,\n"
+	 << "\t   built from the compact case base of mbtg --native\n"
+	 << "\t--unknown-candidates=<n> score at most <n> instances per unknown\n"
+	 << "\t   word. Faster, but no longer exact. (default 0: exact)\n"
+	 << "\t--unknown-scan compare unknown words with all instances, using\n"
+	 << "\t   AVX2 or SSE4.1 when available, instead of the index\n"
+	 << "\t--check-native report how often the native engines disagree with Timbl\n"
 	 << "\t-v di add distance to the output\n"
 	 << "\t-v db add distribution to the output\n"
 	 << "\t-v cf add confidence to the output\n"
+	 << "\t-v tk<n> keep the <n> most likely tags per word (JSON output)\n"
 	 << "\t-V show Version info\n"
 	 << endl;
   }
@@ -0,0 +1,193 @@
+/*
+  Copyright (c) 1998 - 2026
+  CLST  - Radboud University
+  ILK   - Tilburg University
+  CLiPS - University of Antwerp
+
+  This file is part of mbt
+
+  mbt is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  mbt is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/mbt/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <exception>
+
+#include "mbt/Scheduler.h"
+
+namespace Tagger {
+  using namespace std;
+
+  TaskScheduler::TaskScheduler( size_t workers ):
+    /*!
+      construct a scheduler for the given number of workers, and start
+      their threads
+    */
+    num_steals(0),
+    aborted(false),
+    job(0),
+    generation(0),
+    busy(0),
+    stopping(false)
+  {
+    if ( workers == 0 ){
+      workers = 1;
+    }
+    for ( size_t i=0; i < workers; ++i ){
+      queues.push_back( new worker_queue() );
+    }
+    for ( size_t w=0; w < workers; ++w ){
+      threads.push_back( thread( &TaskScheduler::work, this, w ) );
+    }
+  }
+
+  TaskScheduler::~TaskScheduler(){
+    {
+      lock_guard<mutex> guard( batch_lock );
+      stopping = true;
+    }
+    batch_start.notify_all();
+    for ( auto& th : threads ){
+      th.join();
+    }
+    for ( const auto& q : queues ){
+      delete q;
+    }
+  }
+
+  bool TaskScheduler::next_task( size_t worker, size_t& task ){
+    /// get the next task for \e worker
+    /*!
+      A worker first takes the most expensive task from its own deque.
+      When that is empty, it steals the cheapest task from the back of the
+      deque of one of the other workers.
+      \return false when no work is left anywhere
+    */
+    if ( aborted ){
+      return false;
+    }
+    {
+      worker_queue *own = queues[worker];
+      lock_guard<mutex> guard( own->lock );
+      if ( !own->tasks.empty() ){
+	task = own->tasks.front();
+	own->tasks.pop_front();
+	return true;
+      }
+    }
+    for ( size_t i=1; i < queues.size(); ++i ){
+      worker_queue *victim = queues[(worker+i) % queues.size()];
+      lock_guard<mutex> guard( victim->lock );
+      if ( !victim->tasks.empty() ){
+	task = victim->tasks.back();
+	victim->tasks.pop_back();
+	++num_steals;
+	return true;
+      }
+    }
+    return false;
+  }
+
+  void TaskScheduler::work( size_t worker ){
+    /// the loop of the thread of \e worker
+    /*!
+      Wait for a new batch, run tasks until no work is left anywhere,
+      report back to run(), and wait again.
+    */
+    size_t seen = 0;
+    while ( true ){
+      {
+	unique_lock<mutex> guard( batch_lock );
+	batch_start.wait( guard,
+			  [&]{ return stopping || generation != seen; } );
+	if ( stopping ){
+	  return;
+	}
+	seen = generation;
+      }
+      size_t task;
+      try {
+	while ( next_task( worker, task ) ){
+	  (*job)( worker, task );
+	}
+      }
+      catch ( ... ){
+	lock_guard<mutex> guard( batch_lock );
+	if ( !failure ){
+	  failure = current_exception();
+	}
+	aborted = true;
+      }
+      lock_guard<mutex> guard( batch_lock );
+      if ( --busy == 0 ){
+	batch_done.notify_all();
+      }
+    }
+  }
+
+  void TaskScheduler::run( const vector<size_t>& costs,
+			   const function<void(size_t,size_t)>& fun ){
+    /// run \e fun on all tasks, using all workers
+    /*!
+      \param costs the estimated cost of every task
+      \param fun the function to call as fun( worker, task ). Tasks are
+      numbered after their position in \e costs.
+
+      The tasks are dealt out most expensive first, each to the worker
+      with the least work assigned so far. Imbalance due to bad estimates
+      is then repaired by stealing.
+      run() returns when the whole batch is done. It may not be called
+      from several threads at once.
+      The first exception thrown by a job stops all workers, and is
+      rethrown here.
+    */
+    vector<size_t> order( costs.size() );
+    iota( order.begin(), order.end(), 0 );
+    stable_sort( order.begin(), order.end(),
+		 [&costs]( size_t a, size_t b ){ return costs[a] > costs[b]; } );
+    vector<size_t> load( queues.size(), 0 );
+    for ( const auto& task : order ){
+      size_t best = min_element( load.begin(), load.end() ) - load.begin();
+      queues[best]->tasks.push_back( task );
+      load[best] += costs[task] + 1;
+    }
+    exception_ptr failed;
+    {
+      unique_lock<mutex> guard( batch_lock );
+      job = &fun;
+      failure = exception_ptr();
+      aborted = false;
+      busy = queues.size();
+      ++generation;
+      batch_start.notify_all();
+      batch_done.wait( guard, [this]{ return busy == 0; } );
+      job = 0;
+      failed = failure;
+      failure = exception_ptr();
+    }
+    for ( const auto& q : queues ){
+      q->tasks.clear();
+    }
+    if ( failed ){
+      rethrow_exception( failed );
+    }
+  }
+
+}
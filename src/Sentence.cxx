@@ -42,7 +42,6 @@
 #include "mbt/Sentence.h"
 
 namespace Tagger {
-  using namespace Hash;
   using namespace std;
   using namespace icu;
 
@@ -95,6 +94,18 @@ namespace Tagger {
     no_words = 0;
   }
 
+  void sentence::take_over( sentence& in ){
+    /// move all the words of sentence \e in into this sentence
+    /*!
+      \e in is left empty, but keeps its pending input, so it can be used
+      to read the next sentence from the same stream
+    */
+    clear();
+    Words.swap( in.Words );
+    no_words = in.no_words;
+    in.no_words = 0;
+  }
+
   ostream& operator<<( ostream& os, const sentence& s ){
     /// output a \e sentence to a stream \e os
     s.print( os );
@@ -165,12 +176,9 @@ namespace Tagger {
   }
 
   bool sentence::init_windowing( const map<UnicodeString,UnicodeString>& lex,
-				 UnicodeHash& TheLex ) {
+				 SymbolTable& TheLex ) {
     if ( UTAG == -1 ){
-#pragma omp critical (hasher)
-      {
-	UTAG = TheLex.hash( UNKNOWN );
-      }
+      UTAG = TheLex.hash( UNKNOWN );
     }
     if ( no_words == 0 ) {
       //    cerr << "ERROR: empty sentence?!" << endl;
@@ -178,18 +186,12 @@ namespace Tagger {
     }
     else {
       for ( const auto& cur_word : Words ){
-#pragma omp critical (hasher)
-	{
-	  cur_word->the_word_index = TheLex.hash(cur_word->the_word );
-	}
+	cur_word->the_word_index = TheLex.hash(cur_word->the_word );
 	// look up ambiguous tag in the dictionary
 	//
 	const auto it = lex.find( cur_word->the_word );
 	if ( it != lex.end() ){
-#pragma omp critical (hasher)
-	  {
-	    cur_word->word_amb_tag = TheLex.hash( it->second );
-	  }
+	  cur_word->word_amb_tag = TheLex.hash( it->second );
 	}
 	else  {
 	  // cerr << "MT Lookup(" << cur_word->the_word << ") gave NILL" << endl;
@@ -202,7 +204,7 @@ namespace Tagger {
   }
 
   int sentence::classify_hapax( const UnicodeString& word,
-				UnicodeHash& TheLex ) const{
+				SymbolTable& TheLex ) const{
     UnicodeString hap = "HAPAX-";
     if ( word.indexOf( "-" ) != -1 ){
       // hyphen anywere
@@ -223,16 +225,11 @@ namespace Tagger {
       hap += "0";
       //      cerr << "classified HAPAX-0 for: '" << word << "'" << endl;
     }
-    int result = -1;
-#pragma omp critical (hasher)
-    {
-      result = TheLex.hash( hap );
-    }
-    return result;
+    return TheLex.hash( hap );
   }
 
   bool sentence::nextpat( MatchAction& Action, vector<int>& Pat,
-			  UnicodeHash& wordlist, UnicodeHash& TheLex,
+			  SymbolTable& wordlist, SymbolTable& TheLex,
 			  unsigned int position,
 			  const vector<int>& old_pat ) const {
     Pat.clear();
@@ -278,10 +275,7 @@ namespace Tagger {
 	else {
 	  addChars += '=';  // "_=" denotes "no value"
 	}
-#pragma omp critical (hasher)
-	{
-	  Pat.push_back( TheLex.hash( addChars ) );
-	}
+	Pat.push_back( TheLex.hash( addChars ) );
       }
     }
 
@@ -318,10 +312,7 @@ namespace Tagger {
 	}
       }
       else {   // Out of context.
-#pragma omp critical (hasher)
-	{
-	  Pat.push_back( TheLex.hash( DOT ) );
-	}
+	Pat.push_back( TheLex.hash( DOT ) );
       }
     } // i
 
@@ -361,10 +352,7 @@ namespace Tagger {
 	}
       }
       else {   // Out of context.
-#pragma omp critical (hasher)
-	{
-	  Pat.push_back( TheLex.hash( DOT ) );
-	}
+	Pat.push_back( TheLex.hash( DOT ) );
       }
     } // i
 
@@ -379,10 +367,7 @@ namespace Tagger {
 	else {
 	  addChars += '=';
 	}
-#pragma omp critical (hasher)
-	{
-	  Pat.push_back( TheLex.hash( addChars ) );
-	}
+	Pat.push_back( TheLex.hash( addChars ) );
       }
     }
 
@@ -396,10 +381,7 @@ namespace Tagger {
       else {
 	addChars = "_0";
       }
-#pragma omp critical (hasher)
-      {
-	Pat.push_back( TheLex.hash( addChars ) );
-      }
+      Pat.push_back( TheLex.hash( addChars ) );
     }
 
     // Capital (First Letter)?
@@ -412,10 +394,7 @@ namespace Tagger {
       else {
 	addChars += '0';
       }
-#pragma omp critical (hasher)
-      {
-	Pat.push_back( TheLex.hash( addChars ) );
-      }
+      Pat.push_back( TheLex.hash( addChars ) );
     }
 
     // Numeric (somewhere in word)?
@@ -428,10 +407,7 @@ namespace Tagger {
 	  break;
 	}
       }
-#pragma omp critical (hasher)
-      {
-	Pat.push_back( TheLex.hash( addChars ) );
-      }
+      Pat.push_back( TheLex.hash( addChars ) );
     }
     return true;
   }
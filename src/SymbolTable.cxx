@@ -0,0 +1,293 @@
+/*
+  Copyright (c) 1998 - 2026
+  CLST  - Radboud University
+  ILK   - Tilburg University
+  CLiPS - University of Antwerp
+
+  This file is part of mbt
+
+  mbt is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  mbt is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/mbt/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+#include <stdexcept>
+#include "mbt/SymbolTable.h"
+
+namespace Tagger {
+  using namespace std;
+  using namespace icu;
+
+  //
+  // The table consists of NUM_SHARDS hash tables. A symbol lives in the
+  // shard selected by the low bits of its hash value.
+  // Every shard is an array of chains of immutable nodes. A new node is
+  // only made visible to readers after it is complete, by an atomic store
+  // into the head of its chain. When a shard grows, a complete new array
+  // with new nodes is built and then published. The old array and nodes
+  // stay valid for readers that still use them, until the table dies.
+  //
+  // The strings are stored in segments of doubling size, indexed by
+  // symbol number, so they never move once stored. A new symbol gets its
+  // number and its string under id_lock, and the number is published in
+  // entries only after the string is stored.
+  //
+
+  SymbolTable::bucket_array::bucket_array( size_t n ):
+    size(n),
+    heads( new atomic<node*>[n] )
+  {
+    for ( size_t i=0; i < n; ++i ){
+      heads[i].store( 0, memory_order_relaxed );
+    }
+  }
+
+  SymbolTable::bucket_array::~bucket_array(){
+    delete [] heads;
+  }
+
+  SymbolTable::shard::shard():
+    buckets( new bucket_array( 16 ) ),
+    count(0)
+  {
+  }
+
+  SymbolTable::shard::~shard(){
+    delete buckets.load();
+    for ( const auto& b : retired ){
+      delete b;
+    }
+    for ( const auto& n : nodes ){
+      delete n;
+    }
+  }
+
+  SymbolTable::SymbolTable():
+    entries(0),
+    base(0),
+    base_size(0)
+  {
+    for ( auto& s : segments ){
+      s.store( 0, memory_order_relaxed );
+    }
+  }
+
+  SymbolTable::~SymbolTable(){
+    for ( auto& s : segments ){
+      delete [] s.load();
+    }
+  }
+
+  inline size_t bucket_index( int32_t h, size_t size ){
+    // the low 6 bits select one of the NUM_SHARDS shards, so skip them
+    return ( static_cast<uint32_t>(h) >> 6 ) & ( size - 1 );
+  }
+
+  inline void segment_of( unsigned int id,
+			  size_t first_size,
+			  size_t& segment,
+			  size_t& offset ){
+    // segment k holds first_size * 2^k symbols
+    size_t i = id - 1;
+    size_t q = i / first_size + 1;
+    segment = 0;
+    while ( q >>= 1 ){
+      ++segment;
+    }
+    offset = i - first_size * ( ( size_t(1) << segment ) - 1 );
+  }
+
+  unsigned int SymbolTable::find( const shard& sh,
+				  int32_t h,
+				  const UnicodeString& name ) const {
+    const bucket_array *b = sh.buckets.load( memory_order_acquire );
+    const node *n = b->heads[bucket_index( h, b->size )].load( memory_order_acquire );
+    while ( n ){
+      if ( n->hash_val == h && local_symbol( n->id ) == name ){
+	return n->id;
+      }
+      n = n->next;
+    }
+    return 0;
+  }
+
+  unsigned int SymbolTable::lookup( const UnicodeString& name ) const {
+    /// find the number of symbol \e name
+    /*!
+      \return the symbol number, or 0 when \e name is not in the table
+    */
+    if ( base ){
+      unsigned int id = base->lookup( name );
+      if ( id ){
+	return id;
+      }
+    }
+    int32_t h = name.hashCode();
+    unsigned int id = find( shards[h & (NUM_SHARDS-1)], h, name );
+    return id ? base_size + id : 0;
+  }
+
+  unsigned int SymbolTable::hash( const UnicodeString& name ){
+    /// find the number of symbol \e name, and add it when it is new
+    if ( base ){
+      unsigned int id = base->lookup( name );
+      if ( id ){
+	return id;
+      }
+    }
+    int32_t h = name.hashCode();
+    shard& sh = shards[h & (NUM_SHARDS-1)];
+    unsigned int id = find( sh, h, name );
+    if ( id ){
+      return base_size + id;
+    }
+    lock_guard<mutex> guard( sh.lock );
+    // another thread might have inserted it in the mean time
+    id = find( sh, h, name );
+    if ( id ){
+      return base_size + id;
+    }
+    {
+      // store the string before the new number is published, so anyone
+      // who sees the number in entries also sees its string
+      lock_guard<mutex> id_guard( id_lock );
+      id = entries.load( memory_order_relaxed ) + 1;
+      slot( id ) = name;
+      entries.store( id, memory_order_release );
+    }
+    if ( sh.count >= 2 * sh.buckets.load( memory_order_relaxed )->size ){
+      grow( sh );
+    }
+    bucket_array *b = sh.buckets.load( memory_order_relaxed );
+    atomic<node*>& head = b->heads[bucket_index( h, b->size )];
+    node *n = new node( h, id, head.load( memory_order_relaxed ) );
+    sh.nodes.push_back( n );
+    head.store( n, memory_order_release );
+    ++sh.count;
+    return base_size + id;
+  }
+
+  void SymbolTable::set_base( const SymbolTable *b ){
+    /// stack this table on top of \e b
+    /*!
+      The table must be empty, and \e b may not change anymore as long
+      as this table uses it.
+    */
+    if ( entries > 0 ){
+      throw logic_error( "SymbolTable::set_base() on a non empty table" );
+    }
+    base = b;
+    base_size = b ? b->num_of_entries() : 0;
+  }
+
+  void SymbolTable::clear(){
+    /// remove all symbols that were added to this table
+    /*!
+      The symbols of a base table are kept. Not to be called while other
+      threads are using this table.
+    */
+    if ( entries == 0 ){
+      return;
+    }
+    for ( auto& sh : shards ){
+      if ( sh.count == 0 ){
+	continue;
+      }
+      for ( const auto& b : sh.retired ){
+	delete b;
+      }
+      sh.retired.clear();
+      for ( const auto& n : sh.nodes ){
+	delete n;
+      }
+      sh.nodes.clear();
+      bucket_array *b = sh.buckets.load( memory_order_relaxed );
+      for ( size_t i=0; i < b->size; ++i ){
+	b->heads[i].store( 0, memory_order_relaxed );
+      }
+      sh.count = 0;
+    }
+    // keep the string segments for re-use, but empty the strings
+    for ( unsigned int id=1; id <= entries; ++id ){
+      slot( id ).remove();
+    }
+    entries = 0;
+  }
+
+  void SymbolTable::grow( shard& sh ){
+    // called with sh.lock held
+    // Readers may still walk the old array, so it is only retired. The
+    // retired arrays and their nodes are freed by clear(), or when the
+    // table is destroyed. As the arrays double, that at most doubles the
+    // memory of a shard.
+    bucket_array *old = sh.buckets.load( memory_order_relaxed );
+    bucket_array *fresh = new bucket_array( 2 * old->size );
+    for ( size_t i=0; i < old->size; ++i ){
+      const node *n = old->heads[i].load( memory_order_relaxed );
+      while ( n ){
+	atomic<node*>& head = fresh->heads[bucket_index( n->hash_val, fresh->size )];
+	node *copy = new node( n->hash_val, n->id, head.load( memory_order_relaxed ) );
+	sh.nodes.push_back( copy );
+	head.store( copy, memory_order_relaxed );
+	n = n->next;
+      }
+    }
+    sh.buckets.store( fresh, memory_order_release );
+    sh.retired.push_back( old );
+  }
+
+  UnicodeString& SymbolTable::slot( unsigned int id ){
+    // called with id_lock held, or by clear()
+    size_t segment;
+    size_t offset;
+    segment_of( id, FIRST_SEGMENT, segment, offset );
+    UnicodeString *seg = segments[segment].load( memory_order_relaxed );
+    if ( !seg ){
+      seg = new UnicodeString[FIRST_SEGMENT << segment];
+      segments[segment].store( seg, memory_order_release );
+    }
+    return seg[offset];
+  }
+
+  const UnicodeString& SymbolTable::local_symbol( unsigned int id ) const {
+    // the string of symbol \e id, numbered without the base
+    static const UnicodeString empty;
+    if ( id == 0 || id > entries.load( memory_order_acquire ) ){
+      return empty;
+    }
+    size_t segment;
+    size_t offset;
+    segment_of( id, FIRST_SEGMENT, segment, offset );
+    const UnicodeString *seg = segments[segment].load( memory_order_acquire );
+    if ( !seg ){
+      return empty;
+    }
+    return seg[offset];
+  }
+
+  const UnicodeString& SymbolTable::reverse_lookup( unsigned int id ) const {
+    /// return the string value of symbol number \e id
+    /*!
+      \return the symbol, or an empty string for an unknown number
+    */
+    if ( id <= base_size ){
+      return base ? base->reverse_lookup( id ) : local_symbol( 0 );
+    }
+    return local_symbol( id - base_size );
+  }
+
+}
@@ -34,6 +34,10 @@
 #include <cstring>
 #include <string>
 
+#include "config.h"
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
 #include "ticcutils/StringOps.h"
 #include "ticcutils/Unicode.h"
 #include "mbt/TagLex.h"
@@ -59,6 +63,14 @@ namespace Tagger {
     ++TagFreqs[tag];
   }
 
+  void TagInfo::Merge( const TagInfo& other ){
+    /// add the counts of \e other, for the same word, to ours
+    WordFreq += other.WordFreq;
+    for ( const auto& it : other.TagFreqs ){
+      TagFreqs[it.first] += it.second;
+    }
+  }
+
   void TagInfo::Prune( int Threshold ){
     auto it = TagFreqs.begin();
     while ( it != TagFreqs.end() ){
@@ -149,11 +161,28 @@ namespace Tagger {
     vec->push_back( TI );
   }
 
+  void TagLex::Merge( const TagLex& other ){
+    /// add all the counts of \e other to this lexicon
+    vector<TagInfo*> infos;
+    other.TagTree->ForEachDo( StoreInVector, static_cast<void *>(&infos) );
+    for ( const auto *ti : infos ){
+      TagInfo *info = TagTree->Retrieve( ti->Word );
+      if ( info ){
+	info->Merge( *ti );
+      }
+      else {
+	NumOfEntries++;
+	TagTree->Store( ti->Word, new TagInfo( *ti ) );
+      }
+    }
+  }
+
   bool ascendingInfo( const TagInfo* t1, const TagInfo* t2 ){
     //
     // sort on decending frequency
-    // when same frequency, sort alphabetical
-    // but: sort Uppercase words before lowercase when equal (e.g Land/land)
+    // when same frequency, sort alphabetical, ignoring case
+    // and sort Uppercase words before lowercase when equal (e.g Land/land)
+    // This is a strict weak order, so every sort gives the same outcome
     //
     int diff = t2->Freq() - t1->Freq();
     if ( diff == 0 ){
@@ -162,19 +191,60 @@ namespace Tagger {
       UnicodeString u2 = t2->Word;
       u2.toLower();
       if ( u2 == u1 ){
-	return t2->Word < t1->Word;
+	return t1->Word < t2->Word;
       }
       else {
-	return t1->Word < t2->Word;
+	return u1 < u2;
       }
     }
     return diff < 0;
   }
 
+  const size_t MIN_PARALLEL_SORT = 10000;
+
+  void parallel_sort( vector<TagInfo*>& vec ){
+    //
+    // sort parts of the vector in parallel, and then merge them pairwise.
+    // ascendingInfo() orders any two different words, so the outcome is
+    // the same as for a sequential sort, for any number of parts
+    //
+    size_t parts = 1;
+#ifdef HAVE_OPENMP
+    parts = omp_get_max_threads();
+#endif
+    if ( parts < 2 || vec.size() < MIN_PARALLEL_SORT ){
+      sort( vec.begin(), vec.end(), ascendingInfo );
+      return;
+    }
+    vector<size_t> bounds( parts+1 );
+    for ( size_t i=0; i <= parts; ++i ){
+      bounds[i] = ( vec.size() * i ) / parts;
+    }
+#pragma omp parallel for
+    for ( long i=0; i < (long)parts; ++i ){
+      sort( vec.begin() + bounds[i], vec.begin() + bounds[i+1], ascendingInfo );
+    }
+    for ( size_t step=1; step < parts; step *= 2 ){
+      long pairs = ( parts + 2*step - 1 ) / ( 2*step );
+#pragma omp parallel for
+      for ( long p=0; p < pairs; ++p ){
+	size_t lo = p * 2 * step;
+	size_t mid = lo + step;
+	if ( mid < parts ){
+	  size_t hi = min( lo + 2*step, parts );
+	  inplace_merge( vec.begin() + bounds[lo],
+			 vec.begin() + bounds[mid],
+			 vec.begin() + bounds[hi],
+			 ascendingInfo );
+	}
+      }
+    }
+  }
+
   vector<TagInfo *> TagLex::CreateSortedVector(){
     vector<TagInfo*> TagVec;
     TagTree->ForEachDo( StoreInVector, static_cast<void *>(&TagVec) );
-    sort( TagVec.begin(), TagVec.end() , ascendingInfo );
+    parallel_sort( TagVec );
     return TagVec;
   }
 
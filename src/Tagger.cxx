@@ -45,6 +45,11 @@
 #include "mbt/Sentence.h"
 #include "mbt/Logging.h"
 #include "mbt/Tagger.h"
+#include "mbt/ClassifyCache.h"
+#include "mbt/CaseBase.h"
+#include "mbt/NativeIB1.h"
+#include "mbt/Bundle.h"
+#include "mbt/Scheduler.h"
 
 #if defined(HAVE_PTHREAD)
 #include <pthread.h>
@@ -61,15 +66,16 @@ LogStream default_cout( cout );
 LogLevel internal_default_level = LogNormal;
 LogLevel Tagger_Log_Level       = internal_default_level;
 
-const double DATA_VERSION=2.0;
+const double DATA_VERSION=2.1;
+const double MIN_DATA_VERSION=2.0; // still readable
 
 namespace Tagger {
-  using namespace Hash;
   using namespace Timbl;
 
   string Version() { return VERSION; }
   string VersionName() { return PACKAGE_STRING; }
   double DataVersion() { return DATA_VERSION; }
+  double MinDataVersion() { return MIN_DATA_VERSION; }
 
   const string UNKSTR   = "UNKNOWN";
 
@@ -83,6 +89,14 @@ namespace Tagger {
     default_cout.set_stamp( NoStamp );
     KnownTree = NULL;
     unKnownTree = NULL;
+    lazy_unknown = false;
+    recombine = false;
+    beam_threshold = 0.0;
+    beam_budget = 0;
+    beam_expanded = 0;
+    beam_positions = 0;
+    unknown_loaded = false;
+    unknown_master = 0;
     TimblOptStr = "+vS -FColumns K: -a IGTREE +D U: -a IB1 ";
     FilterThreshold = 5;
     Npax = 5;
@@ -99,10 +113,36 @@ namespace Tagger {
     Separators = "\t \n";
     initialized = false;
     Beam_Size = 1;
+    context_depth = 0;
+    num_threads = 0;
+    cache_size = 0;
+    cache = 0;
+    fast_unambiguous = false;
+    check_unambiguous = false;
+    unambiguous_checked = 0;
+    unambiguous_disagreements = 0;
+    write_native = false;
+    native_known = false;
+    check_native = false;
+    NativeKnown = 0;
+    native_checked = 0;
+    native_disagreements = 0;
+    native_unknown = false;
+    unknown_candidates = 0;
+    unknown_scan = false;
+    NativeUnknown = 0;
+    ib1_scratch = 0;
+    native_unknown_checked = 0;
+    native_unknown_disagreements = 0;
+    native_unknown_ties = 0;
+    write_bundle = false;
+    bundleflag = false;
+    ModelBundle = 0;
     Beam = NULL;
     MT_lexicon = new map<UnicodeString,UnicodeString>;
-    kwordlist = new UnicodeHash();
-    uwordlist = new UnicodeHash();
+    BaseLex = 0;
+    kwordlist = new SymbolTable();
+    uwordlist = new SymbolTable();
     piped_input = true;
     input_kind = UNTAGGED;
     lexflag = false;
@@ -118,14 +158,32 @@ namespace Tagger {
     distrib_flag = false;
     confidence_flag = false;
     klistflag= false;
+    topk_size = 0;
+    need_distribution = true;
+    need_distance = true;
     cloned = false;
+    batch_scheduler = 0;
   }
 
   TaggerClass::TaggerClass( const TaggerClass& in ):
     cur_log( in.cur_log ),         //!> is a pointer to avoid copies
-    KnownTree( in.KnownTree ),
-    unKnownTree( in.unKnownTree ),
+    // the Trees are child experiments, sharing the InstanceBase with
+    // the parent, but with their own classification state
+    KnownTree( in.KnownTree ? new TimblAPI( *in.KnownTree ) : 0 ),
+    // with --lazy-unknown, a clone of a tagger without the unknown words
+    // case base gets its child experiment later, see ensure_unknown_tree()
+    unKnownTree( in.unKnownTree && in.unknown_loaded
+		 ? new TimblAPI( *in.unKnownTree ) : 0 ),
+    lazy_unknown( in.lazy_unknown ),
+    recombine( in.recombine ),
+    beam_threshold( in.beam_threshold ),
+    beam_budget( in.beam_budget ),
+    beam_expanded( 0 ),
+    beam_positions( 0 ),
+    unknown_loaded( in.unknown_loaded.load() ),
+    unknown_master( in.unknown_master ? in.unknown_master : &in ),
     initialized( in.initialized ),
+    BaseLex( in.BaseLex ),         //!> is a pointer to avoid copies
     kwordlist( in.kwordlist ),     //!> is a pointer to avoid copies
     uwordlist( in.uwordlist ),     //!> is a pointer to avoid copies
     Beam( 0 ),                     //!> reset pointer
@@ -144,7 +202,35 @@ namespace Tagger {
     distrib_flag( in.distrib_flag ),
     confidence_flag( in.confidence_flag ),
     klistflag( in.klistflag ),
+    topk_size( in.topk_size ),
+    need_distribution( in.need_distribution ),
+    need_distance( in.need_distance ),
     Beam_Size( in.Beam_Size ),
+    context_depth( in.context_depth ),
+    num_threads( 0 ),              //!> a clone is always single threaded
+    cache_size( in.cache_size ),
+    cache( 0 ),
+    fast_unambiguous( in.fast_unambiguous ),
+    check_unambiguous( in.check_unambiguous ),
+    unambiguous_checked( 0 ),
+    unambiguous_disagreements( 0 ),
+    write_native( in.write_native ),
+    native_known( in.native_known ),
+    check_native( in.check_native ),
+    NativeKnown( in.NativeKnown ),   //!> is a pointer to avoid copies
+    native_checked( 0 ),
+    native_disagreements( 0 ),
+    native_unknown( in.native_unknown ),
+    unknown_candidates( in.unknown_candidates ),
+    unknown_scan( in.unknown_scan ),
+    NativeUnknown( in.NativeUnknown ), //!> is a pointer to avoid copies
+    ib1_scratch( in.NativeUnknown ? new IB1Scratch() : 0 ),
+    native_unknown_checked( 0 ),
+    native_unknown_disagreements( 0 ),
+    native_unknown_ties( 0 ),
+    write_bundle( in.write_bundle ),
+    bundleflag( in.bundleflag ),
+    ModelBundle( in.ModelBundle ),   //!> is a pointer to avoid copies
     TimblOptStr( in.TimblOptStr ),
     FilterThreshold( in.FilterThreshold ),
     Npax( in.Npax ),
@@ -167,19 +253,28 @@ namespace Tagger {
     MTLexFileBaseName( in.MTLexFileBaseName ),
     TopNFileBaseName( in.TopNFileBaseName ),
     NpaxFileBaseName( in.NpaxFileBaseName),
+    BundleBaseName( in.BundleBaseName ),
     UnknownTreeName( in.UnknownTreeName),
     KnownTreeName( in.KnownTreeName),
     LexFileName( in.LexFileName),
     MTLexFileName( in.MTLexFileName),
     TopNFileName( in.TopNFileName),
     NpaxFileName( in.NpaxFileName),
+    BundleName( in.BundleName ),
     TestFileName( in.TestFileName),
     TestFilePath( in.TestFilePath),
     OutputFileName( in.OutputFileName),
     SettingsFileName( in.SettingsFileName),
     SettingsFilePath( in.SettingsFilePath ),
-    cloned( true )
+    cloned( true ),
+    batch_scheduler( 0 )
   {
+    // the words of the test sentences end up in our own overlay
+    TheLex.set_base( BaseLex );
+    if ( in.cache ){
+      // every clone caches on its own, so no locking is needed
+      cache = new ClassifyCache( cache_size );
+    }
   }
 
   bool TaggerClass::setLog( LogStream& os ){
@@ -198,7 +293,7 @@ namespace Tagger {
   }
 
   const UnicodeString& indexlex( const unsigned int index,
-				 UnicodeHash& aLex){
+				 SymbolTable& aLex){
     return aLex.reverse_lookup( index );
   }
 
@@ -206,10 +301,20 @@ namespace Tagger {
     DBG << "classify total took: " << timer1 << endl;
     DBG << "classify known took: " << timer2 << endl;
     DBG << "classify unknown took: " << timer3 << endl;
+    delete batch_scheduler;
+    for ( const auto& w : batch_workers ){
+      delete w;
+    }
+    delete KnownTree;
+    delete unKnownTree;
+    delete cache;
+    delete ib1_scratch;
     if ( !cloned ){
-      delete KnownTree;
-      delete unKnownTree;
       delete MT_lexicon;
+      delete BaseLex;
+      delete NativeKnown;
+      delete NativeUnknown;
+      delete ModelBundle; // after the engines that use it
       delete kwordlist;
       delete uwordlist;
       delete cur_log;
@@ -394,6 +499,11 @@ namespace Tagger {
     NpaxFileBaseName = TestFileName + affix;
     NpaxFileName = prefixWithAbsolutePath( NpaxFileBaseName,
 					   SettingsFilePath );
+    if ( !bundleflag ){
+      BundleBaseName = TestFileName + ".bundle";
+      BundleName = prefixWithAbsolutePath( BundleBaseName,
+					   SettingsFilePath );
+    }
     return true;
   }
 
@@ -0,0 +1,121 @@
+/*
+  Copyright (c) 1998 - 2026
+  CLST  - Radboud University
+  ILK   - Tilburg University
+  CLiPS - University of Antwerp
+
+  This file is part of mbt
+
+  mbt is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  mbt is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/mbt/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#include <cstdlib>
+#include <new>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include "mbt/Tagger.h"
+using namespace std;
+using namespace Tagger;
+
+// micro benchmarks of parts of the tagger that don't need Timbl, run by
+// 'make bench'
+
+static size_t allocations = 0;
+
+void *operator new( size_t size ){
+  // count the heap allocations, to check that none are made per word
+  ++allocations;
+  void *p = malloc( size ? size : 1 );
+  if ( !p ){
+    throw bad_alloc();
+  }
+  return p;
+}
+
+void operator delete( void *p ) noexcept {
+  free( p );
+}
+
+void operator delete( void *p, size_t ) noexcept {
+  free( p );
+}
+
+void make_distributions( int classes, vector<Classification>& dists ){
+  // distributions over \e classes tags, with counts like Timbl's. The
+  // answer is the most frequent tag
+  mt19937 gen( classes );
+  uniform_int_distribution<int> count( 1, 100 );
+  for ( auto& cl : dists ){
+    cl.clear();
+    double best = 0;
+    for ( int c=0; c < classes; ++c ){
+      double w = count( gen );
+      cl.distribution.push_back( make_pair( c+1, w ) );
+      if ( w > best ){
+	best = w;
+	cl.answer = c+1;
+      }
+    }
+  }
+}
+
+void time_break_down(){
+  cout << "break_down(), per call:" << endl;
+  cout << "  " << setw(8) << "classes" << setw(6) << "beam"
+       << setw(10) << "ns" << setw(14) << "allocations" << endl;
+  const int widths[] = { 2, 12, 50, 150, 500, 1000 };
+  const size_t beams[] = { 3, 10, 20 };
+  vector<Classification> dists( 64 );
+  vector<tag_prob> scratch;
+  for ( const auto& classes : widths ){
+    make_distributions( classes, dists );
+    for ( const auto& beam : beams ){
+      // warm up, so the scratch space has grown
+      for ( const auto& cl : dists ){
+	break_down( cl, beam, scratch );
+      }
+      size_t calls = max( 1000, 4000000 / classes );
+      double check = 0.0;
+      size_t before = allocations;
+      auto start = chrono::steady_clock::now();
+      for ( size_t i=0; i < calls; ++i ){
+	break_down( dists[i % dists.size()], beam, scratch );
+	check += scratch[0].prob;
+      }
+      auto took = chrono::steady_clock::now() - start;
+      size_t allocated = allocations - before;
+      double ns = chrono::duration<double,nano>( took ).count() / calls;
+      cout << "  " << setw(8) << classes << setw(6) << beam
+	   << setw(10) << fixed << setprecision(1) << ns
+	   << setw(14) << allocated << endl;
+      if ( check <= 0.0 ){
+	cerr << "break_down() gave no probabilities" << endl;
+	exit( EXIT_FAILURE );
+      }
+    }
+  }
+}
+
+int main(){
+  time_break_down();
+  return EXIT_SUCCESS;
+}
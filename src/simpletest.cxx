@@ -27,11 +27,142 @@
 */
 
 #include <cstdlib>
+#include <cassert>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <sstream>
 #include "mbt/MbtAPI.h"
+#include "mbt/CaseBase.h"
+#include "mbt/TagLex.h"
 using namespace std;
 using namespace Tagger;
 
+bool run_mbt( const string& args ){
+  // run the mbt command line with \e args
+  vector<string> words;
+  words.push_back( "mbt" );
+  istringstream is( args );
+  string word;
+  while ( is >> word ){
+    words.push_back( word );
+  }
+  vector<char*> argv;
+  for ( auto& w : words ){
+    argv.push_back( &w[0] );
+  }
+  argv.push_back( 0 );
+  return MbtAPI::RunTagger( words.size(), argv.data() );
+}
+
+string file_contents( const string& name ){
+  ifstream is( name );
+  ostringstream os;
+  os << is.rdbuf();
+  return os.str();
+}
+
+void check_symbol_table(){
+  // a symbol that is counted in num_of_entries() must have its string,
+  // also while other threads are adding symbols
+  SymbolTable table;
+  atomic<bool> done( false );
+  thread reader( [&]{
+      while ( !done ){
+	unsigned int n = table.num_of_entries();
+	for ( unsigned int id=1; id <= n; ++id ){
+	  assert( !table.reverse_lookup( id ).isEmpty() );
+	}
+      }
+    } );
+  vector<thread> writers;
+  for ( int w=0; w < 2; ++w ){
+    writers.push_back( thread( [&table,w]{
+	  for ( int i=0; i < 5000; ++i ){
+	    icu::UnicodeString sym = icu::UnicodeString::fromUTF8( to_string( 2*i+w ) );
+	    unsigned int id = table.hash( sym );
+	    assert( table.reverse_lookup( id ) == sym );
+	  }
+	} ) );
+  }
+  for ( auto& th : writers ){
+    th.join();
+  }
+  done = true;
+  reader.join();
+  assert( table.num_of_entries() == 10000 );
+}
+
+void check_lexicon_order(){
+  // words of equal frequency are sorted alphabetically, ignoring case,
+  // and Uppercase before lowercase. This must hold for any number of
+  // threads, so the lexicon is big enough to be sorted in parallel
+  TagLex lex;
+  for ( int i=0; i < 20000; ++i ){
+    icu::UnicodeString word = icu::UnicodeString::fromUTF8( "w" + to_string( i ) );
+    lex.Store( word, "N" );
+    if ( i % 2 == 0 ){
+      lex.Store( word, "N" );
+      word.toUpper();
+      lex.Store( word, "N" );
+      lex.Store( word, "N" );
+    }
+  }
+  for ( const auto& word : { "lb", "land", "Lb", "Land" } ){
+    lex.Store( word, "N" );
+  }
+  vector<TagInfo*> sorted = lex.CreateSortedVector();
+  assert( sorted.size() == 30004 );
+  for ( size_t i=1; i < sorted.size(); ++i ){
+    const TagInfo *t1 = sorted[i-1];
+    const TagInfo *t2 = sorted[i];
+    assert( t1->Freq() >= t2->Freq() );
+    if ( t1->Freq() == t2->Freq() ){
+      icu::UnicodeString u1 = t1->Word;
+      u1.toLower();
+      icu::UnicodeString u2 = t2->Word;
+      u2.toLower();
+      assert( u1 < u2 || ( u1 == u2 && t1->Word < t2->Word ) );
+    }
+  }
+  size_t pos = 0;
+  while ( sorted[pos]->Word != "Land" ){
+    ++pos;
+  }
+  assert( sorted[pos+1]->Word == "land" );
+  assert( sorted[pos+2]->Word == "Lb" );
+  assert( sorted[pos+3]->Word == "lb" );
+}
+
+void check_cache_with_filtered_tag(){
+  // 'de' is tagged Zeldzaam too rarely to be in its ambitag, but Timbl
+  // still answers Zeldzaam after 'qq'. That answer must not come out of
+  // the --cache in a later sentence under another name
+  ofstream data( "./rare.data" );
+  for ( int i=0; i < 30; ++i ){
+    data << "de\tArt\nkat\tN\nslaapt\tV\n.\tPunc\n<utt>\n";
+  }
+  data << "qq\tQ\nde\tZeldzaam\nkat\tN\n.\tPunc\n<utt>\n";
+  data.close();
+  ofstream test( "./rare.test" );
+  test << "qq\tQ\nde\tZeldzaam\nkat\tN\n.\tPunc\n<utt>\n"
+       << "de\tArt\nkat\tN\nslaapt\tV\n.\tPunc\n<utt>\n"
+       << "qq\tQ\nde\tZeldzaam\nkat\tN\n.\tPunc\n<utt>\n";
+  test.close();
+  MbtAPI::GenerateTagger( "-T ./rare.data -s ./rare.setting" );
+  bool ok = run_mbt( "-s ./rare.setting -T ./rare.test -o ./rare.out" );
+  assert( ok );
+  ok = run_mbt( "-s ./rare.setting --cache=100 -T ./rare.test"
+		" -o ./rare_cache.out" );
+  assert( ok );
+  string plain = file_contents( "./rare.out" );
+  assert( plain.find( "\tZeldzaam\n" ) != string::npos );
+  assert( plain == file_contents( "./rare_cache.out" ) );
+}
+
 int main(){
+  check_symbol_table();
+  check_lexicon_order();
   string path;
   const char *ev = getenv( "topsrcdir" );
   if ( ev ){
@@ -49,4 +180,96 @@ int main(){
   vector<TagResult> v = demo.TagLine( "Test regel 2 ." );
   assert( v[0].assigned_tag() == "N" );
   assert( v[2].confidence() == -1 );
+  // a pool of 2 sessions, shared by 4 threads
+  MbtAPI pooled( "-s ./simple.setting -j 2" );
+  assert( pooled.poolSize() == 2 );
+  icu::UnicodeString expected = demo.Tag( "Test regel 2 ." );
+  vector<thread> threads;
+  for ( int t=0; t < 4; ++t ){
+    threads.push_back( thread( [&]{
+	  for ( int i=0; i < 10; ++i ){
+	    icu::UnicodeString tagged = pooled.Tag( "Test regel 2 ." );
+	    assert( tagged == expected );
+	  }
+	} ) );
+  }
+  for ( auto& th : threads ){
+    th.join();
+  }
+  assert( pooled.poolRequests() == 40 );
+  check_cache_with_filtered_tag();
+  // a batch of lines is spread over the clones by the scheduler, and
+  // must give the answers of TagLine(), in the same order
+  vector<icu::UnicodeString> lines = { "Test regel 2 .",
+				       "dit is een test",
+				       "Dit is een veel langere regel , met nog meer woorden .",
+				       "kort" };
+  for ( int i=0; i < 2; ++i ){
+    // the second batch reuses the clones and threads of the first
+    vector<vector<TagResult>> batch = pooled.TagLines( lines );
+    assert( batch.size() == lines.size() );
+    for ( size_t l=0; l < lines.size(); ++l ){
+      assert( demo.getResult( batch[l] )
+	      == demo.getResult( demo.TagLine( lines[l] ) ) );
+    }
+  }
+  // the -j pipeline must give exactly the output of a serial run
+  string test_file = path + "/example/eindh.test";
+  bool ok = run_mbt( "-s ./simple.setting -B 3 -T " + test_file
+		     + " -o ./serial.out" );
+  assert( ok );
+  ok = run_mbt( "-s ./simple.setting -B 3 -j 3 -T " + test_file
+		+ " -o ./parallel.out" );
+  assert( ok );
+  string serial = file_contents( "./serial.out" );
+  assert( !serial.empty() );
+  assert( serial == file_contents( "./parallel.out" ) );
+  // and so must the threads of -j, when they read the unknown words
+  // case base lazily
+  ok = run_mbt( "-s ./simple.setting -B 3 -j 3 --lazy-unknown -T " + test_file
+		+ " -o ./lazy.out" );
+  assert( ok );
+  assert( serial == file_contents( "./lazy.out" ) );
+  // the native IGTREE must give Timbl's answers and distributions
+  SymbolTable symbols;
+  FlatIGTree tree;
+  ok = tree.read( "./eindh.data.known.ddfa", symbols );
+  assert( ok );
+  assert( tree.num_nodes() > 1 );
+  ok = run_mbt( "-s ./simple.setting -v db+cf -T " + test_file
+		+ " -o ./timbl.out" );
+  assert( ok );
+  ok = run_mbt( "-s ./simple.setting -v db+cf --native-known -T " + test_file
+		+ " -o ./native.out" );
+  assert( ok );
+  string timbl = file_contents( "./timbl.out" );
+  assert( timbl.find( "{ " ) != string::npos );
+  assert( timbl == file_contents( "./native.out" ) );
+  // a model bundle must tag exactly like the text files it was made from
+  command = "-T " + path + "/example/eindh.data -s ./bundle.setting"
+    " --native --bundle";
+  MbtAPI::GenerateTagger( command );
+  ok = run_mbt( "-s ./bundle.setting -v db+cf --native-known -T " + test_file
+		+ " -o ./bundle.out" );
+  assert( ok );
+  assert( timbl == file_contents( "./bundle.out" ) );
+  ok = run_mbt( "-s ./simple.setting -B 3 --native-unknown -T " + test_file
+		+ " -o ./text_ib1.out" );
+  assert( ok );
+  ok = run_mbt( "-s ./bundle.setting -B 3 --native-unknown -T " + test_file
+		+ " -o ./bundle_ib1.out" );
+  assert( ok );
+  string text_ib1 = file_contents( "./text_ib1.out" );
+  assert( !text_ib1.empty() );
+  assert( text_ib1 == file_contents( "./bundle_ib1.out" ) );
+  // the distributions and distances of the unknown words are Timbl's
+  // too, so --native-unknown must leave those to Timbl
+  ok = run_mbt( "-s ./simple.setting -v db+di -T " + test_file
+		+ " -o ./timbl_di.out" );
+  assert( ok );
+  ok = run_mbt( "-s ./simple.setting -v db+di --native-unknown -T "
+		+ test_file + " -o ./native_di.out" );
+  assert( ok );
+  assert( file_contents( "./timbl_di.out" )
+	  == file_contents( "./native_di.out" ) );
 }
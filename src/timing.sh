@@ -0,0 +1,90 @@
+#!/bin/bash
+#
+# timing.sh - time mbt on the example data, in several configurations
+#
+# Run by 'make bench'. The times are only reported: the script fails when
+# mbtg or mbt fails, never because something is slow.
+#
+# usage: topsrcdir=<mbt sources> ./timing.sh [<repeats>]
+#   the test file is tagged <repeats> times over (default 10), because
+#   one pass over eindh.test is too short to time
+
+top=`cd ${topsrcdir:-..} && pwd`
+bin=`pwd`
+repeats=${1:-10}
+cpus=`nproc 2>/dev/null || echo 1`
+TIMEFORMAT=%R
+
+$bin/mbtbench || exit 1
+
+rm -rf timing.d
+mkdir timing.d && cd timing.d || exit 1
+
+echo "training on $top/example/eindh.data"
+for model in text bundle; do
+  if [ $model = bundle ]; then
+    extra=--bundle
+  else
+    extra=
+  fi
+  $bin/mbtg -T $top/example/eindh.data -s ./$model.setting --native $extra \
+      > mbtg.$model.log 2>&1
+  if [ $? -ne 0 ]; then
+    cat mbtg.$model.log
+    exit 1
+  fi
+done
+
+for (( i=0; i < repeats; i++ )); do
+  cat $top/example/eindh.test
+done > test.txt
+echo "tagging eindh.test $repeats times over, on $cpus cpus"
+
+run(){
+  # run mbt with the options in $2... and report the wall clock time, the
+  # number of words per second and the accuracy against the gold tags
+  label=$1
+  shift
+  t=`{ time $bin/mbt -T ./test.txt -o ./out.txt "$@" > mbt.log 2>&1; } 2>&1`
+  if [ $? -ne 0 ]; then
+    cat mbt.log
+    exit 1
+  fi
+  words=`sed -n 's/^Done: \([0-9]*\) words processed.*/\1/p' mbt.log`
+  wps=`awk -v w=${words:-0} -v t=$t 'BEGIN{ if ( t > 0 ) printf "%d", w/t; else print "-" }'`
+  acc=`sed -n 's/.*correct from [0-9]* (\(.*\) %).*/\1/p' mbt.log`
+  printf "  %-36s %6s s %8s words/s %8s %% correct\n" "$label" $t $wps ${acc:--}
+}
+
+echo "configurations:"
+run "plain"                     -s ./text.setting
+run "--cache=100000"            -s ./text.setting --cache=100000
+run "--fast-unambiguous"        -s ./text.setting --fast-unambiguous
+run "--native-known"            -s ./text.setting --native-known
+run "--native-unknown"          -s ./text.setting --native-unknown
+run "--unknown-scan"            -s ./text.setting --unknown-scan
+run "--lazy-unknown"            -s ./text.setting --lazy-unknown
+run "bundle, native"            -s ./bundle.setting --native-known --native-unknown
+run "-B 3"                      -s ./text.setting -B 3
+run "-B 3 --beam-threshold=0.01" -s ./text.setting -B 3 --beam-threshold=0.01
+run "-B 3 --beam-budget=1"      -s ./text.setting -B 3 --beam-budget=1
+
+echo "beam sizes:"
+for b in 1 2 3 4 5 7 10 15 20; do
+  run "-B $b"                   -s ./text.setting -B $b
+done
+
+echo "--recombine against the plain beam search:"
+for b in 2 3 5 10; do
+  run "-B $b"                   -s ./text.setting -B $b
+  run "-B $b --recombine"       -s ./text.setting -B $b --recombine
+done
+
+echo "threads, up to the number of cpus:"
+for (( j=1; j <= cpus; j++ )); do
+  run "-j $j"                   -s ./text.setting -j $j
+done
+for (( j=1; j <= cpus; j++ )); do
+  run "-B 3 -j $j"              -s ./text.setting -B 3 -j $j
+done
+exit 0